@@ -0,0 +1,339 @@
+/*
+********************************************************************************
+* --------------------------------- SciRooPlot ---------------------------------
+* Copyright (c) 2019-2023 Mario Krüger
+* Contact: mario.kruger@cern.ch
+* For a full list of contributors please see doc/CONTRIBUTORS.md.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation in version 3 (or later) of the License.
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+* See the GNU General Public License for more details.
+* The GNU General Public License can be found here: <http://www.gnu.org/licenses/>.
+*******************************************************************************
+*/
+
+#include "SciRooPlot.h"
+#include "PlotManager.h"
+#include "PlotPainter.h"
+#include "Plot.h"
+#include "Logging.h"
+#include "Helpers.h"
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TList.h"
+#include "TH1.h"
+#include "TH2.h"
+#include "THnSparse.h"
+#include "TCanvas.h"
+#include "TRandom3.h"
+
+using namespace SciRooPlot;
+namespace po = boost::program_options;
+
+//**************************************************************************************************
+/**
+ * Benchmarks for the individual phases of plot creation (load, paint, save).
+ * The synthetic inputs are generated in the style of example/generateMWE.C and the
+ * results are written as json such that they can be compared between releases.
+ */
+//**************************************************************************************************
+namespace
+{
+using data_buffer_t = unordered_map<string, unordered_map<string, unique_ptr<TObject>>>;
+
+struct settings_t {
+  string inputDir;
+  uint32_t repetitions{};
+  uint32_t nKeys{};
+  uint32_t listDepth{};
+  uint32_t nBins2D{};
+  uint32_t nFill{};
+  uint32_t nRowsCSV{};
+};
+
+struct result_t {
+  string name;
+  vector<double_t> timesMS;
+};
+
+//**************************************************************************************************
+/**
+ * Generate the synthetic input files.
+ */
+//**************************************************************************************************
+void GenerateInputs(const settings_t& settings)
+{
+  std::filesystem::create_directories(settings.inputDir);
+  TRandom3 random(42);
+
+  // many keys in one directory
+  {
+    TFile file((settings.inputDir + "/keys.root").data(), "RECREATE");
+    for (uint32_t i = 0; i < settings.nKeys; ++i) {
+      TH1D hist(("hist_" + std::to_string(i)).data(), "", 100, 0., 6.);
+      for (uint32_t j = 0; j < 1000; ++j)
+        hist.Fill(random.Gaus(3., 1.));
+      hist.Write();
+    }
+  }
+
+  // deeply nested lists
+  {
+    TFile file((settings.inputDir + "/nested.root").data(), "RECREATE");
+    vector<unique_ptr<TList>> lists;
+    for (uint32_t level = 0; level < settings.listDepth; ++level) {
+      lists.push_back(std::make_unique<TList>());
+      lists.back()->SetOwner(true);
+      lists.back()->SetName(("level_" + std::to_string(level)).data());
+      for (uint32_t i = 0; i < 50; ++i) {
+        auto hist = new TH1D(("hist_" + std::to_string(level) + "_" + std::to_string(i)).data(), "", 100, 0., 6.);
+        for (uint32_t j = 0; j < 1000; ++j)
+          hist->Fill(random.Gaus(3., 1.));
+        lists.back()->Add(hist);
+      }
+    }
+    for (uint32_t level = settings.listDepth - 1; level > 0; --level) {
+      lists[level - 1]->Add(lists[level].release());
+    }
+    lists.front()->Write("list", TObject::kSingleKey);
+  }
+
+  // large multi-dimensional histograms
+  {
+    TFile file((settings.inputDir + "/large.root").data(), "RECREATE");
+    TH2D hist2d("hist2d", "", settings.nBins2D, 0., 6., settings.nBins2D, 0., 6.);
+    TH1D numerator("numerator", "", settings.nBins2D * settings.nBins2D, 0., 6.);
+    TH1D denominator("denominator", "", settings.nBins2D * settings.nBins2D, 0., 6.);
+    const int32_t nDims{4};
+    int32_t bins[nDims] = {100, 100, 100, 100};
+    double_t min[nDims] = {0., 0., 0., 0.};
+    double_t max[nDims] = {6., 6., 6., 6.};
+    THnSparseD sparse("sparse", "", nDims, bins, min, max);
+    for (uint32_t j = 0; j < settings.nFill; ++j) {
+      double_t x = random.Gaus(3., 1.);
+      double_t y = random.Gaus(3., 1.);
+      hist2d.Fill(x, y);
+      numerator.Fill(x);
+      denominator.Fill(y);
+      double_t values[nDims] = {x, y, random.Uniform(0., 6.), random.Uniform(0., 6.)};
+      sparse.Fill(values);
+    }
+    hist2d.Write();
+    numerator.Write();
+    denominator.Write();
+    sparse.Write();
+  }
+
+  // csv table
+  {
+    std::ofstream csvFile(settings.inputDir + "/table.csv");
+    for (uint32_t i = 0; i < settings.nRowsCSV; ++i) {
+      double_t x = 6. * i / settings.nRowsCSV;
+      csvFile << x << "\t" << random.Gaus(3., 1.) << "\t" << 0.5 * 6. / settings.nRowsCSV << "\t" << 0.1 << "\n";
+    }
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Load all objects needed for the painting benchmarks (without going through the PlotManager).
+ */
+//**************************************************************************************************
+data_buffer_t LoadPaintingInputs(const settings_t& settings)
+{
+  data_buffer_t dataBuffer;
+  bool addDirStatus = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(false);
+  TFile file((settings.inputDir + "/large.root").data(), "READ");
+  for (const string& name : {"hist2d", "numerator", "denominator", "sparse"}) {
+    if (TObject* obj = file.Get(name.data())) {
+      dataBuffer["large"][name].reset(obj->Clone());
+    } else {
+      ERROR("Could not find {} in benchmark inputs.", name);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  TH1::AddDirectory(addDirStatus);
+  return dataBuffer;
+}
+
+//**************************************************************************************************
+/**
+ * Run function repeatedly and record the wall time of each repetition.
+ */
+//**************************************************************************************************
+result_t Measure(const string& name, uint32_t repetitions, const std::function<void()>& function)
+{
+  result_t result{name, {}};
+  for (uint32_t i = 0; i < repetitions; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+    result.timesMS.push_back(std::chrono::duration<double_t, std::milli>(end - start).count());
+  }
+  std::sort(result.timesMS.begin(), result.timesMS.end());
+  INFO("{:<30} median {:>10.3f} ms   min {:>10.3f} ms   max {:>10.3f} ms", name, result.timesMS[result.timesMS.size() / 2], result.timesMS.front(), result.timesMS.back());
+  return result;
+}
+
+//**************************************************************************************************
+/**
+ * Write the results in a machine-readable format.
+ */
+//**************************************************************************************************
+void WriteResults(const string& outputFileName, const settings_t& settings, const vector<result_t>& results)
+{
+  std::ofstream outputFile(expand_path(outputFileName));
+  outputFile << "{\n";
+  outputFile << fmt::format("  \"root_version\": {},\n", gROOT->GetVersionInt());
+  outputFile << fmt::format("  \"settings\": {{\"repetitions\": {}, \"keys\": {}, \"list_depth\": {}, \"bins_2d\": {}, \"fill\": {}, \"csv_rows\": {}}},\n",
+                            settings.repetitions, settings.nKeys, settings.listDepth, settings.nBins2D, settings.nFill, settings.nRowsCSV);
+  outputFile << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto& times = results[i].timesMS;
+    double_t mean = std::accumulate(times.begin(), times.end(), 0.) / times.size();
+    outputFile << fmt::format("    {{\"name\": \"{}\", \"unit\": \"ms\", \"median\": {}, \"mean\": {}, \"min\": {}, \"max\": {}}}{}\n",
+                              results[i].name, times[times.size() / 2], mean, times.front(), times.back(), (i + 1 < results.size()) ? "," : "");
+  }
+  outputFile << "  ]\n}\n";
+  INFO("Wrote benchmark results to {}.", outputFileName);
+}
+} // end anonymous namespace
+
+int main(int argc, char* argv[])
+{
+  settings_t settings;
+  string outputFileName;
+  bool skipGeneration{};
+  try {
+    po::options_description options("options");
+    options.add_options()("help,h", "show this help")(
+      "inputs", po::value<string>(&settings.inputDir)->default_value((std::filesystem::temp_directory_path() / "SciRooPlotBenchmarks").string()), "directory for the generated inputs")(
+      "output,o", po::value<string>(&outputFileName)->default_value("benchmarks.json"), "file the results are written to (json)")(
+      "repetitions,r", po::value<uint32_t>(&settings.repetitions)->default_value(5u), "number of repetitions per benchmark")(
+      "keys", po::value<uint32_t>(&settings.nKeys)->default_value(10000u), "number of keys in the flat input file")(
+      "depth", po::value<uint32_t>(&settings.listDepth)->default_value(10u), "nesting depth of the input lists")(
+      "bins", po::value<uint32_t>(&settings.nBins2D)->default_value(1000u), "number of bins per axis of the 2d histogram")(
+      "fill", po::value<uint32_t>(&settings.nFill)->default_value(1000000u), "number of entries filled into the large histograms")(
+      "rows", po::value<uint32_t>(&settings.nRowsCSV)->default_value(100000u), "number of rows in the csv input")(
+      "skip-generation", po::bool_switch(&skipGeneration), "re-use inputs generated by a previous run");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    if (vm.count("help")) {
+      std::cout << options << std::endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+  } catch (std::exception& e) {
+    ERROR("{}", e.what());
+    return EXIT_FAILURE;
+  }
+  if (settings.repetitions == 0u || settings.listDepth == 0u || settings.nRowsCSV == 0u) {
+    ERROR("Repetitions, list depth and csv rows must be larger than zero.");
+    return EXIT_FAILURE;
+  }
+  gROOT->SetBatch(true);
+
+  if (!skipGeneration) {
+    INFO("Generating benchmark inputs in {}.", settings.inputDir);
+    GenerateInputs(settings);
+  }
+  string outputDir = settings.inputDir + "/output";
+  std::filesystem::create_directories(outputDir);
+  vector<result_t> results;
+
+  // loading: plots are created by the manager, the inputs are chosen such that the lookup dominates
+  // the manager (and with it the ROOT application) is set up only once, so the repetitions only measure the loading itself
+  PlotManager plotManager;
+  plotManager.SetIndexCacheDirectory("");
+  plotManager.SetTextExtentCacheFile("");
+  plotManager.SetOutputDirectory(outputDir);
+  plotManager.SetOutputFileName("loading.root");
+  auto measureLoading = [&](const string& name, const string& inputFile, const vector<string>& dataNames) {
+    plotManager.AddInputDataFiles(name, {settings.inputDir + "/" + inputFile});
+    results.push_back(Measure(name, settings.repetitions, [&]() {
+      plotManager.ClearPlots();
+      plotManager.ClearDataBuffer();
+      Plot plot("loading_" + name, "benchmarks");
+      for (auto& dataName : dataNames) {
+        plot[1].AddData(dataName, name);
+      }
+      plotManager.AddPlot(plot);
+      plotManager.CreatePlots("", "", {}, "file");
+    }));
+  };
+  measureLoading("load_flat_keys", "keys.root", {"hist_0", "hist_" + std::to_string(settings.nKeys / 2), "hist_" + std::to_string(settings.nKeys - 1)});
+  measureLoading("load_nested_lists", "nested.root", {"hist_0_0", "hist_" + std::to_string(settings.listDepth - 1) + "_49"});
+  measureLoading("load_csv", "table.csv", {"table"});
+
+  // painting: the painter works directly on a pre-filled data buffer
+  data_buffer_t dataBuffer = LoadPaintingInputs(settings);
+  Plot templatePlot1d = PlotManager::GetPlotTemplate("1d");
+  Plot templatePlot2d = PlotManager::GetPlotTemplate("2d");
+  Plot templatePlotRatio = PlotManager::GetPlotTemplate("1d_ratio");
+  auto measurePainting = [&](const string& name, const Plot& plot, bool borrowData = false) {
+    results.push_back(Measure(name, settings.repetitions, [&]() {
+      Plot fullPlot = plot;
+      PlotPainter painter(borrowData);
+      unique_ptr<TCanvas> canvas{painter.GeneratePlot(fullPlot, dataBuffer)};
+      if (!canvas) ERROR("Benchmark plot {} could not be created.", name);
+    }));
+  };
+
+  Plot plot2d("clone", "benchmarks");
+  plot2d[1].AddData("hist2d", "large");
+  measurePainting("paint_clone_th2", templatePlot2d + plot2d);
+  measurePainting("paint_borrow_th2", templatePlot2d + plot2d, true);
+
+  Plot plotProjection("projection", "benchmarks");
+  plotProjection[1].AddData("hist2d", "large").SetProjectionX(0., 3., true);
+  plotProjection[1].AddData("sparse", "large", "sparse").SetProjection({0}, {{1, 0., 3.}}, true);
+  measurePainting("paint_projection", templatePlot1d + plotProjection);
+
+  Plot plotRatio("ratio", "benchmarks");
+  plotRatio[1].AddData("numerator", "large");
+  plotRatio[1].AddData("denominator", "large");
+  plotRatio[2].AddRatio("numerator", "large", "denominator", "large");
+  measurePainting("paint_ratio", templatePlotRatio + plotRatio);
+
+  Plot plotBoxes("boxes", "benchmarks");
+  for (uint32_t i = 0; i < 20; ++i) {
+    plotBoxes[1].AddData("numerator", "large", "entry #" + std::to_string(i) + " with mean <mean[.2f]> and integral <integral>");
+  }
+  plotBoxes[1].AddLegend();
+  plotBoxes[1].AddText("#bf{SciRooPlot} benchmark // synthetic input // box auto-sizing");
+  measurePainting("paint_box_autosize", templatePlot1d + plotBoxes);
+
+  // saving: the same canvas is written in each output format
+  {
+    Plot fullPlot = templatePlotRatio + plotRatio;
+    PlotPainter painter;
+    unique_ptr<TCanvas> canvas{painter.GeneratePlot(fullPlot, dataBuffer)};
+    if (canvas) {
+      for (const string& format : {"pdf", "png", "eps", "svg", "C", "root"}) {
+        string fileName = outputDir + "/save." + format;
+        results.push_back(Measure("save_" + format, settings.repetitions, [&]() { canvas->SaveAs(fileName.data()); }));
+      }
+    } else {
+      ERROR("Canvas for the output benchmarks could not be created.");
+    }
+  }
+
+  WriteResults(outputFileName, settings, results);
+  return EXIT_SUCCESS;
+}
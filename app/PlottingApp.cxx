@@ -26,9 +26,176 @@
 
 #include "Helpers.h"
 
+#include <cerrno>
+#include <csignal>
+#include <filesystem>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
 using namespace SciRooPlot;
 namespace po = boost::program_options;
 
+// requests are sent as one line (figureGroupAndCategory, plotNames and mode separated by tabs) and the daemon replies with its log output
+const string gDaemonSocketName = "~/.cache/sciroot/plot-daemon.socket";
+
+//**************************************************************************************************
+/**
+ * Unix domain socket address of the plotting daemon.
+ */
+//**************************************************************************************************
+bool get_daemon_address(sockaddr_un& address)
+{
+  string socketName = expand_path(gDaemonSocketName);
+  address = {};
+  address.sun_family = AF_UNIX;
+  if (socketName.size() >= sizeof(address.sun_path)) {
+    ERROR("Path of daemon socket {} is too long.", socketName);
+    return false;
+  }
+  socketName.copy(address.sun_path, socketName.size());
+  return true;
+}
+
+//**************************************************************************************************
+/**
+ * Windows have to be opened on the display of the caller and searches need no data, so these modes are not handled by the daemon.
+ */
+//**************************************************************************************************
+bool is_daemon_mode(const string& mode)
+{
+  return mode != "interactive" && mode != "find";
+}
+
+//**************************************************************************************************
+/**
+ * Connects to a running plotting daemon. Returns -1 if there is none.
+ */
+//**************************************************************************************************
+int32_t connect_to_daemon()
+{
+  sockaddr_un address;
+  if (!get_daemon_address(address)) return -1;
+  int32_t connection = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (connection < 0) return -1;
+  if (connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    close(connection);
+    return -1;
+  }
+  return connection;
+}
+
+//**************************************************************************************************
+/**
+ * Sends request to the daemon and prints its reply.
+ */
+//**************************************************************************************************
+bool send_to_daemon(int32_t connection, const string& figureGroupAndCategory, const string& plotNames, const string& mode)
+{
+  string request = figureGroupAndCategory + '\t' + plotNames + '\t' + mode + '\n';
+  bool success = (write(connection, request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+  char reply[4096];
+  for (ssize_t nBytes = read(connection, reply, sizeof(reply)); success && nBytes > 0; nBytes = read(connection, reply, sizeof(reply))) {
+    success = (write(STDOUT_FILENO, reply, nBytes) == nBytes);
+  }
+  close(connection);
+  return success;
+}
+
+//**************************************************************************************************
+/**
+ * Keeps the plot manager alive and handles the requests of the clients one after another.
+ * Plot definitions, templates and input data stay in memory between the requests. Only the parts that belong to
+ * files that were modified in the meantime are read again.
+ */
+//**************************************************************************************************
+int32_t run_daemon(PlotManager& plotManager, const string& inputFiles, const std::function<void(const string&, const string&, const string&)>& handleRequest)
+{
+  sockaddr_un address;
+  if (!get_daemon_address(address)) return 1;
+  int32_t existingDaemon = connect_to_daemon();
+  if (existingDaemon >= 0) {
+    close(existingDaemon);
+    ERROR("Plotting daemon is already running.");
+    return 1;
+  }
+  std::error_code errorCode;
+  std::filesystem::create_directories(std::filesystem::path(address.sun_path).parent_path(), errorCode);
+  unlink(address.sun_path); // left over from a daemon that did not shut down properly
+  int32_t server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0 || bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(server, 16) < 0) {
+    ERROR("Cannot open daemon socket {}.", address.sun_path);
+    return 1;
+  }
+  std::signal(SIGPIPE, SIG_IGN); // clients may disconnect before the reply is complete
+
+  auto getModificationTime = [](const string& fileName) {
+    std::error_code errorCode;
+    return std::filesystem::last_write_time(expand_path(fileName), errorCode);
+  };
+  auto inputFilesTime = getModificationTime(inputFiles);
+  plotManager.LoadInputDataFiles(inputFiles);
+  INFO("Plotting daemon is waiting for requests on {}.", address.sun_path);
+
+  while (true) {
+    int32_t connection = accept(server, nullptr, nullptr);
+    if (connection < 0) {
+      if (errno == EINTR) continue;
+      ERROR("Daemon socket was closed.");
+      break;
+    }
+    string request;
+    char character{};
+    while (read(connection, &character, 1) == 1 && character != '\n') {
+      request += character;
+    }
+    vector<string> fields = split_string(request, '\t');
+    if (fields.size() < 2u) {
+      close(connection);
+      continue;
+    }
+    fields.resize(3u);
+    if (fields[2].empty()) fields[2] = "interactive";
+    if (!is_daemon_mode(fields[2])) {
+      string reply = fmt::format(RED_ "[ ERR  ]" _END " Mode {} cannot be handled by the plotting daemon.\n", fields[2]);
+      static_cast<void>(write(connection, reply.data(), reply.size()));
+      close(connection);
+      WARNING("Rejected request {} {} {}.", fields[0], fields[1], fields[2]);
+      continue;
+    }
+
+    // the log output of the request is sent to the client
+    fflush(stdout);
+    fflush(stderr);
+    int32_t savedStdout = dup(STDOUT_FILENO);
+    int32_t savedStderr = dup(STDERR_FILENO);
+    dup2(connection, STDOUT_FILENO);
+    dup2(connection, STDERR_FILENO);
+
+    if (auto curInputFilesTime = getModificationTime(inputFiles); curInputFilesTime != inputFilesTime) {
+      inputFilesTime = curInputFilesTime;
+      plotManager.ClearDataBuffer();
+      plotManager.LoadInputDataFiles(inputFiles);
+    } else {
+      plotManager.ClearOutdatedData();
+    }
+    plotManager.ClearPlots();
+    handleRequest(fields[0], fields[1], fields[2]);
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(savedStdout, STDOUT_FILENO);
+    dup2(savedStderr, STDERR_FILENO);
+    close(savedStdout);
+    close(savedStderr);
+    close(connection);
+    INFO("Handled request {} {} {}.", fields[0], fields[1], fields[2]);
+  }
+  close(server);
+  unlink(address.sun_path);
+  return 1;
+}
+
 int main(int argc, char* argv[])
 {
 
@@ -80,11 +247,19 @@ int main(int argc, char* argv[])
   string mode;
   string figureGroupAndCategory;
   string plotNames;
+  uint32_t numWorkers{1u};
+  bool useIncrementalMode{};
+  optional<uint64_t> memoryBudget;
+  string traceFileName;
+  bool isDaemon{};
+  bool isWatchMode{};
+  string shard;
+  optional<uint32_t> nMergedShards;
 
   // handle user inputs
   try {
     po::options_description arguments("positional arguments");
-    arguments.add_options()("figureGroupAndCategory", po::value<string>(), "figure group")("plotNames", po::value<string>(), "plot name")("mode", po::value<string>(), "mode");
+    arguments.add_options()("figureGroupAndCategory", po::value<string>(), "figure group")("plotNames", po::value<string>(), "plot name")("mode", po::value<string>(), "mode")("jobs,j", po::value<uint32_t>(), "number of parallel workers")("incremental,i", po::bool_switch(&useIncrementalMode), "only re-create plots that changed")("memory-budget", po::value<uint64_t>(), "stream input data and keep buffer below this size (MB)")("trace", po::value<string>(&traceFileName), "write timing and memory trace of the run to this file (json)")("daemon", po::bool_switch(&isDaemon), "keep running and serve the requests of subsequent plot calls")("watch,w", po::bool_switch(&isWatchMode), "re-create the plots whenever their definition or input files change")("shard", po::value<string>(&shard), "create only part i/N of the plots (e.g. on one of N batch nodes)")("merge-shards", po::value<uint32_t>(), "combine the outputs of N shards");
     po::positional_options_description pos;
     pos.add("figureGroupAndCategory", 1);
     pos.add("plotNames", 1);
@@ -103,6 +278,15 @@ int main(int argc, char* argv[])
     if (vm.count("mode")) {
       mode = vm["mode"].as<string>();
     }
+    if (vm.count("jobs")) {
+      numWorkers = vm["jobs"].as<uint32_t>();
+    }
+    if (vm.count("memory-budget")) {
+      memoryBudget = vm["memory-budget"].as<uint64_t>();
+    }
+    if (vm.count("merge-shards")) {
+      nMergedShards = vm["merge-shards"].as<uint32_t>();
+    }
   } catch (std::exception& e) {
     ERROR(R"(Exception "{}"! Exiting.)", e.what());
     return 1;
@@ -113,30 +297,69 @@ int main(int argc, char* argv[])
 
   if (mode.empty()) mode = "interactive";
 
-  if (plotNames.empty()) {
-    ERROR("No plots were specified.");
-    return 1;
+  if (!isDaemon && !nMergedShards) {
+    if (plotNames.empty()) {
+      ERROR("No plots were specified.");
+      return 1;
+    }
+    // a running daemon already has definitions and data in memory
+    if (int32_t connection = (isWatchMode || !is_daemon_mode(mode)) ? -1 : connect_to_daemon(); connection >= 0) {
+      return (send_to_daemon(connection, figureGroupAndCategory, plotNames, mode)) ? 0 : 1;
+    }
   }
 
   // create plotting environment
   PlotManager plotManager;
   plotManager.SetOutputDirectory(outputDir);
-
-  string group = ".+";
-  string category = ".*";
-
-  vector<string> groupCat = split_string(figureGroupAndCategory, '/', true);
-  if (groupCat.size() > 0 && !groupCat[0].empty()) {
-    group = groupCat[0];
+  plotManager.SetNumWorkers(numWorkers);
+  plotManager.SetNumReaderThreads(numWorkers);
+  plotManager.SetNumProjectionThreads(numWorkers);
+  plotManager.SetUseIncrementalMode(useIncrementalMode);
+  plotManager.SetUseAsyncOutput(); // overlap writing of the output files with painting
+  plotManager.SetIndexCacheDirectory(); // speeds up startup by remembering the content of input files
+  plotManager.SetTextExtentCacheFile(); // speeds up the layout of legends and text boxes
+  if (memoryBudget) plotManager.SetUseStreamingMode(true, *memoryBudget);
+  if (!traceFileName.empty()) plotManager.SetTraceFile(traceFileName);
+  if (nMergedShards) {
+    plotManager.MergeShards(*nMergedShards);
+    return 0;
   }
-  if (groupCat.size() > 1 && !groupCat[1].empty()) {
-    category = groupCat[1];
-    category += "(/.*)?"; // search also in subcategories
+  if (!shard.empty()) {
+    vector<string> shardIDs = split_string(shard, '/');
+    try {
+      if (shardIDs.size() != 2u) throw std::invalid_argument(shard);
+      plotManager.SetShard(std::stoul(shardIDs[0]), std::stoul(shardIDs[1]));
+    } catch (...) {
+      ERROR(R"(Invalid shard "{}". Please specify it as i/N.)", shard);
+      return 1;
+    }
   }
 
+  auto handleRequest = [&](const string& figureGroupAndCategory, const string& plotNames, const string& mode, bool isWatchMode = false) {
+    string group = ".+";
+    string category = ".*";
+
+    vector<string> groupCat = split_string(figureGroupAndCategory, '/', true);
+    if (groupCat.size() > 0 && !groupCat[0].empty()) {
+      group = groupCat[0];
+    }
+    if (groupCat.size() > 1 && !groupCat[1].empty()) {
+      category = groupCat[1];
+      category += "(/.*)?"; // search also in subcategories
+    }
+    if (isWatchMode) {
+      plotManager.WatchPlots(plotDefinitions, mode, plotNames, group, category);
+    } else {
+      plotManager.ExtractPlotsFromFile(plotDefinitions, mode, plotNames, group, category);
+    }
+  };
+
+  if (isDaemon) {
+    return run_daemon(plotManager, inputFiles, handleRequest);
+  }
   if (mode != "find") {
     plotManager.LoadInputDataFiles(inputFiles);
   }
-  plotManager.ExtractPlotsFromFile(plotDefinitions, mode, plotNames, group, category);
+  handleRequest(figureGroupAndCategory, plotNames, mode, isWatchMode);
   return 0;
 }
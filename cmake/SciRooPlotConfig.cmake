@@ -60,6 +60,12 @@ if(DISABLE_PRINT)
   add_compile_definitions(DISABLE_PRINT)
 endif()
 
+option(DISABLE_PROFILING "remove the profiling instrumentation" OFF)
+if(DISABLE_PROFILING)
+  message(STATUS "disabling profiling")
+  add_compile_definitions(DISABLE_PROFILING)
+endif()
+
 set(REQUIRED_ROOT_VERSION 6.16)
 set(REQUIRED_BOOST_VERSION 1.65)
 set(REQUIRED_FMT_VERSION 6.1.2)
@@ -95,6 +101,8 @@ endif()
 find_package(fmt ${REQUIRED_FMT_VERSION} REQUIRED)
 message(STATUS "fmt   version: ${fmt_VERSION}")
 
+find_package(Threads REQUIRED)
+
 include_directories(
   ${SCIROOPLOT_ROOT}/include
 )
@@ -105,6 +113,7 @@ set(SCIROOPLOT_DEPENDENCIES
   ROOT::Gpad
   Boost::program_options
   fmt::fmt
+  Threads::Threads
   ${CXX_FILESYSTEM_LIBRARIES}
 )
 
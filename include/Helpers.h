@@ -27,6 +27,13 @@ namespace SciRooPlot
 string expand_path(const string& path);
 vector<string> split_string(const string& argString, char delimiter, bool onlyFirst = false);
 bool file_exists(const string& name);
+vector<string> split_input_file_path(const string& inputFilePath); // file name and (if specified) sub-directory within the file
+
+// checks if file is accessed via a remote protocol (e.g. root:// or https://)
+inline bool is_remote_file(const string& fileName)
+{
+  return fileName.find("://") != string::npos;
+}
 
 inline bool str_contains(const string& str, const string& substr, bool reverseSearch = false)
 {
@@ -37,6 +44,18 @@ inline bool str_contains(const string& str, const string& substr, bool reverseSe
   }
 }
 
+// checks if path is folder itself or any of its sub-folders (empty folder corresponds to top level)
+inline bool is_in_folder(const string& path, const string& folder)
+{
+  return folder.empty() || path == folder || path.rfind(folder + "/", 0) == 0;
+}
+
+// checks if pattern contains special characters of regular expressions or can be compared literally
+inline bool is_regex(const string& pattern)
+{
+  return pattern.find_first_of(".^$|()[]{}*+?\\") != string::npos;
+}
+
 template <typename T>
 void set_if(const optional<T>& origin, optional<T>& target)
 {
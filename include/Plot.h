@@ -72,6 +72,24 @@ enum drawing_options_t : uint8_t {
   candle7,
 };
 
+//**************************************************************************************************
+/**
+ * Label text pre-compiled into literal segments and placeholders (e.g. <name> or <mean[.2f]>),
+ * which are filled with properties of the data when the plot is drawn.
+ */
+//**************************************************************************************************
+struct label_template_t {
+  enum class placeholder_t : uint8_t { none, name, title, entries, integral, mean, maximum, minimum };
+  struct token_t {
+    string literal; // text in front of the placeholder
+    placeholder_t placeholder{placeholder_t::none};
+    string format;   // format string for numerical values
+    string original; // placeholder as written by the user
+  };
+  vector<token_t> tokens;
+  static shared_ptr<const label_template_t> Compile(const string& label); // nullptr if label contains no placeholder
+};
+
 //**************************************************************************************************
 /**
  * Class for internal representation of a plot.
@@ -126,6 +144,7 @@ protected:
   const auto& GetUniqueName() const { return mUniqueName; }
   ptree GetPropertyTree() const;
   auto& GetPads() { return mPads; }
+  const auto& GetPads() const { return mPads; }
 
   const auto& GetHeight() const { return mPlotDimensions.height; }
   const auto& GetWidth() const { return mPlotDimensions.width; }
@@ -243,6 +262,7 @@ protected:
   ptree GetPropertyTree() const;
 
   auto& GetData() { return mData; }
+  const auto& GetData() const { return mData; }
   auto& GetLegendBoxes() { return mLegendBoxes; }
   auto& GetTextBoxes() { return mTextBoxes; }
   uint8_t GetDataCount() const { return mData.size(); };
@@ -392,6 +412,7 @@ public:
   virtual Data& SetTextFormat(const string& textFormat);
   virtual Data& SetNormalize(bool useWidth = false);
   virtual Data& SetScaleFactor(double_t scale);
+  virtual Data& SetDecimation(bool decimate = true);
   virtual Data& SetColor(int16_t color);
   virtual Data& SetMarker(int16_t color, int16_t style, float_t size);
   virtual Data& SetMarkerColor(int16_t color);
@@ -429,6 +450,7 @@ protected:
   const auto& GetType() const { return mType; }
   const auto& GetName() const { return mName; }
   const auto& GetLegendLabel() const { return mLegend.label; }
+  const auto& GetLegendLabelTemplate() const { return mLegend.labelTemplate; }
   const auto& GetLegendID() const { return mLegend.identifier; }
   const auto& GetMarkerColor() const { return mMarker.color; }
   const auto& GetMarkerStyle() const { return mMarker.style; }
@@ -444,6 +466,7 @@ protected:
   const auto& GetTextFormat() const { return mTextFormat; }
   const auto& GetScaleFactor() const { return mModify.scaleFactor; }
   const auto& GetNormMode() const { return mModify.normMode; }
+  const auto& GetDecimation() const { return mModify.decimate; }
   const auto& GetMinRangeX() const { return mRangeX.min; }
   const auto& GetMaxRangeX() const { return mRangeX.max; }
   const auto& GetMinRangeY() const { return mRangeY.min; }
@@ -477,10 +500,12 @@ private:
   struct modify_t {
     optional<uint8_t> normMode; // 0: sum over bin contents, 1: with bin width
     optional<double_t> scaleFactor;
+    optional<bool> decimate; // reduce the drawn points to what the pad can resolve
   };
   struct legend_t {
     optional<string> label;
     optional<uint8_t> identifier;
+    shared_ptr<const label_template_t> labelTemplate;
   };
 
   struct dataRange_t {
@@ -542,6 +567,7 @@ public:
   Ratio& SetTextFormat(const string& textFormat) { return static_cast<decltype(*this)&>(Data::SetTextFormat(textFormat)); }
   Ratio& SetNormalize(bool useWidth = false) { return static_cast<decltype(*this)&>(Data::SetNormalize(useWidth)); }
   Ratio& SetScaleFactor(double_t scale) { return static_cast<decltype(*this)&>(Data::SetScaleFactor(scale)); }
+  Ratio& SetDecimation(bool decimate = true) { return static_cast<decltype(*this)&>(Data::SetDecimation(decimate)); }
   Ratio& SetColor(int16_t color) { return static_cast<decltype(*this)&>(Data::SetColor(color)); }
   Ratio& SetMarker(int16_t color, int16_t style, float_t size) { return static_cast<decltype(*this)&>(Data::SetMarker(color, style, size)); }
   Ratio& SetMarkerColor(int16_t color) { return static_cast<decltype(*this)&>(Data::SetMarkerColor(color)); }
@@ -845,7 +871,7 @@ protected:
   const optional<uint8_t>& GetNumColumns() const { return mNumColumns; }
   const optional<string>& GetTitle() const { return mTitle; }
 
-  LegendEntry& AddEntry(const string& name, const string& label);
+  LegendEntry& AddEntry(const string& label, const string& refDataName, const shared_ptr<const label_template_t>& labelTemplate);
 
   const auto& GetEntries() const { return mLegendEntries; }
   const auto& GetDefaultDrawStyle() const { return mDrawStyleDefault; }
@@ -908,6 +934,7 @@ protected:
   ptree GetPropertyTree() const;
   const auto& GetRefDataName() const { return mRefDataName; }
   const auto& GetLabel() const { return mLabel; }
+  const auto& GetLabelTemplate() const { return mLabelTemplate; }
   const auto& GetDrawStyle() const { return mDrawStyle; }
 
   const auto& GetMarkerColor() const { return mMarker.color; }
@@ -928,6 +955,7 @@ protected:
 
 private:
   optional<string> mLabel;
+  shared_ptr<const label_template_t> mLabelTemplate;
   optional<string> mRefDataName;
   optional<string> mDrawStyle;
   layout_t mFill;
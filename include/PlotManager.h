@@ -22,11 +22,23 @@
 #include "SciRooPlot.h"
 #include "Plot.h"
 
+#include <deque>
+#include <filesystem>
+#include <mutex>
+
 class TApplication;
 class TCanvas;
+class TFile;
+class TFileCacheRead;
+class TKey;
+class TCollection;
 
 namespace SciRooPlot
 {
+struct projection_cache_t;
+struct text_extent_cache_t;
+struct layout_pool_t;
+
 //**************************************************************************************************
 /**
  * Central manager class.
@@ -49,19 +61,51 @@ public:
   void SetOutputDirectory(const string& path);
   void SetUseUniquePlotNames(bool useUniquePlotNames = true);          // if true plot names are set to plotName_IN_figureGroup[.pdf,...]
   void SetOutputFileName(const string& fileName = "ResultPlots.root"); // in case canvases should be saved in .root file
+  void SetNumWorkers(uint32_t numWorkers = 1);                         // number of worker processes used to create plots in batch modes
+  void SetUseIncrementalMode(bool useIncrementalMode = true);          // if true only plots with modified definition or input files are re-created
+  void SetIndexCacheDirectory(const string& path = "~/.cache/sciroot"); // keep index of input file contents and plot definitions between runs (disabled if empty)
+  void SetTextExtentCacheFile(const string& fileName = "~/.cache/sciroot/textExtents.txt"); // keep measured text sizes between runs (disabled if empty)
+  void SetTraceFile(const string& fileName = "trace.json");                                  // record timing and memory of the processing phases (disabled if empty)
+  void SetUseAsyncOutput(bool useAsyncOutput = true, uint32_t maxPendingOutputs = 4u);      // encode pdf, png, eps, svg files in helper processes while the next plots are painted
+  void SetShard(uint32_t shardID, uint32_t nShards);                                         // create only the share of plots belonging to shard shardID (1..nShards), e.g. on different batch nodes
+  void MergeShards(uint32_t nShards);                                                        // combine output files ("file" mode) and manifests (incremental mode) of all shards
 
   // settings related to the input root files
   void AddInputDataFiles(const string& inputIdentifier, const vector<string>& inputFilePathList);
   void AddInputDataFile(const string& inputIdentifier, const string& inputFilePath);
   void DumpInputDataFiles(const string& configFileName) const; // save input file paths to config file
   void LoadInputDataFiles(const string& configFileName);       // load the input file paths from config file
+  void SetNumReaderThreads(uint32_t numThreads = 1);           // read data of different inputs concurrently
+  void SetNumProjectionThreads(uint32_t numThreads = 1);       // compute projections of different input data concurrently
+  void SetUseStreamingMode(bool useStreamingMode = true, uint64_t memoryBudget = 0); // keep data only as long as plots need them (budget in MB, 0: unlimited)
+
+  // layout of the csv (or tsv) files of an input; by default each file provides one graph named like the file (without extension)
+  // with the tab separated columns x, y, ex, ey; if graphs are specified they are available as <fileName>/<graphName>
+  struct csv_graph_t {
+    string name;
+    uint8_t x{0u}; // column indices (starting at 0)
+    uint8_t y{1u};
+    optional<uint8_t> ex;
+    optional<uint8_t> ey;
+  };
+  struct csv_format_t {
+    char delimiter{'\t'};
+    char comment{'#'};    // lines starting with this character are ignored
+    uint32_t skipLines{}; // e.g. header lines
+    vector<csv_graph_t> graphs;
+  };
+  void SetCSVFormat(const string& inputIdentifier, const csv_format_t& format);
 
   // remove all loaded input data (histograms, graphs, ...) from the manager (usually not needed)
   void ClearDataBuffer();
+  // remove only the input data whose files were modified after they had been read (for long-running sessions)
+  void ClearOutdatedData();
 
   // add plots or templates for plots to the manager
   void AddPlot(Plot& plot);
+  void AddPlots(vector<Plot>&& plots);
   void AddPlotTemplate(Plot& plotTemplate);
+  void ClearPlots(); // remove all plots and templates from the manager
 
   // saving plot definitions to external file (which can e.g. be read by the command-line plotting app
   // included in the framework)
@@ -76,6 +120,8 @@ public:
                             const string& plotName = ".*",
                             const string& group = ".*",
                             const string& category = ".*");
+  // same as above, but afterwards the plots are re-created whenever their definition or input data change (runs until the program is stopped)
+  void WatchPlots(const string& plotFileName, const string& mode = "pdf", const string& plotName = ".*", const string& group = ".*", const string& category = ".*");
 
   // after desired plots were added to the manager they can be created
   // the program then will try to extract the required input data (TH1,TGraph,..) from the specified
@@ -84,9 +130,24 @@ public:
   // canvas "pdf", "png": plots will be stored as such files in the specified output directory
   // (subdirectories are created for the figure groups and categories) "macro": plots are saved as
   // root macros (.C) "file": all plots (canvases) are put in a .root file with a directory
-  // structure corresponding to figure groups and categories
+  // structure corresponding to figure groups and categories "pdf-book": all plots of a figure group
+  // and category are pages of one pdf file
   void CreatePlots(const string& figureGroup = "", const string& figureCategory = "",
                    vector<string> plotNames = {}, const string& outputMode = "pdf");
+
+  // animated gif of one plot whose data are exchanged from frame to frame (e.g. a sweep over centrality classes or
+  // over the projection ranges of a multi-dimensional histogram); the plot is painted once and only its data are updated
+  struct animation_frame_t {
+    struct data_update_t {
+      uint8_t padID{1u};
+      uint8_t dataID{1u};                                                   // position of the data in the pad (starting at 1)
+      optional<string> name;                                                // data to show instead
+      optional<string> inputIdentifier;                                     // input to take it from
+      optional<vector<tuple<uint8_t, double_t, double_t>>> projectionRanges; // range restrictions for the projection
+    };
+    vector<data_update_t> updates;
+  };
+  bool CreateAnimation(const string& figureGroup, const string& plotName, const vector<animation_frame_t>& frames, uint32_t frameDelay = 50u); // delay in centiseconds
   void CreatePlot(const string& name, const string& figureGroup, const string& figureCategory = "",
                   const string& outputMode = "pdf");
   void PrintLoadedPlots() const;
@@ -94,27 +155,152 @@ public:
 private:
   TObject* FindSubDirectory(TObject* folder, vector<string>& subDirs) const;
   bool GeneratePlot(const Plot& plot, const string& outputMode = "pdf");
-  ptree& ReadPlotTemplatesFromFile(const string& plotFileName);
-  void SavePlotsToFile() const;
+  void CreateSelectedPlots(vector<Plot*> selectedPlots, const string& outputMode);
+  Plot ResolvePlotTemplate(const Plot& plot) const;
+  const Plot* FindPlotTemplate(const Plot& plot) const;
+  string GetOutputFileName(const Plot& plot, const string& outputMode) const;
+  set<std::pair<string, string>> GetRequiredData(const Plot& plot) const;
+  bool GeneratePlots(const vector<Plot*>& plots, const string& outputMode);
+  bool GeneratePlotsStreaming(vector<Plot*> plots, const string& outputMode);
+  void GeneratePlotsParallel(const vector<Plot*>& plots, const string& outputMode);
+  void BrowsePlots(const vector<Plot*>& plots);
+  static uint64_t GetDataSize(const TObject* data);
+
+  // plots created in "file" mode are written right away to the output file, which is kept open during the session
+  TFile* GetOutputFile();
+  bool WriteToOutputFile(const string& uniqueName, TCanvas& canvas);
+  void CloseOutputFile();
+  static std::pair<string, string> GetOutputLocation(const string& uniqueName); // directory, name
+
+  // encoding and writing of the individual output files can overlap with painting the next plots
+  void SaveCanvas(TCanvas& canvas, const string& fileName, bool isAsync);
+  void WaitForPendingOutputs(size_t maxPendingOutputs = 0u);
+  void CreateOutputDirectory(const string& folderName);
+  bool mUseAsyncOutput{};
+  uint32_t mMaxPendingOutputs{4u};
+  std::deque<std::pair<int32_t, string>> mPendingOutputs; // helper process, output file
+  set<string> mCreatedDirectories;
+
+  // in "pdf-book" mode all plots of a figure group and category are pages of one pdf file
+  void AddToPDFBook(TCanvas& canvas, const string& bookName, const Plot& plot);
+  void ClosePDFBook();
+  string mPDFBookName;
+  string mGifName; // all plots created in one go in gif mode are frames of the same file
+  string mGifFolderName;
+  vector<std::pair<string, string>> mPDFBookPages; // plotName, uniqueName
+
+  // book-keeping for incremental mode
+  size_t GetDefinitionHash(const Plot& plot) const;
+  void LoadManifest();
+  void ReadManifest(const string& manifestFileName);
+  void SaveManifest(const string& manifestFileName) const;
+  string GetManifestFileName() const;
+  bool IsUpToDate(const string& outputFile, size_t definitionHash) const;
+  void UpdateManifest(const Plot& plot, const string& outputFile, size_t definitionHash, std::filesystem::file_time_type startTime);
 
   unique_ptr<TApplication> mApp;
-  bool mSaveToRootFile{};
   string mOutputFileName;
-  map<string, shared_ptr<TCanvas>> mPlotLedger;
+  unique_ptr<TFile> mOutputFile;
+  uint32_t mNumPlotsInOutputFile{};
   string mOutputDirectory;
   bool mUseUniquePlotNames{};
+  uint32_t mNumWorkers{1u};
+  bool mUseIncrementalMode{};
+
+  // sharding of the plots among independent runs
+  vector<Plot*> GetShardPlots(const vector<Plot*>& plots, const string& outputMode) const;
+  static string GetShardFileName(const string& fileName, uint32_t shardID, uint32_t nShards);
+  uint32_t mShardID{1u};
+  uint32_t mNumShards{1u};
+  map<string, ptree> mManifest; // outputFile, manifest entry
   vector<Plot> mPlots;
+  unordered_map<string, size_t> mPlotIndex;             // unique name, position in mPlots
+  unordered_map<string, vector<size_t>> mPlotsPerGroup; // figure group, positions in mPlots
   vector<Plot> mPlotTemplates;
-  map<string, ptree> mPropertyTreeCache;
-  vector<const string*> mPlotViewHistory;
+  unordered_map<string, size_t> mPlotTemplateIndex;          // template name, position in mPlotTemplates
+  mutable unordered_map<string, size_t> mPlotTemplateHashes; // template name, hash of its definition
+
+  // index of the plot definitions in a file (stored next to it) such that only the requested plots have to be parsed
+  struct plot_file_entry_t {
+    uint64_t offset{}; // position of the plot definition in the file (bytes)
+    uint64_t length{};
+    string group;
+    string category;
+    string name;
+  };
+  struct plot_file_index_t {
+    int64_t modificationTime{};
+    uintmax_t fileSize{};
+    vector<plot_file_entry_t> entries; // in order of appearance
+  };
+  const plot_file_index_t* GetPlotFileIndex(const string& plotFileName); // nullptr if file cannot be read
+  bool BuildPlotFileIndex(const string& plotFileName, plot_file_index_t& plotFileIndex) const;
+  ptree ReadPlotDefinition(std::istream& plotFile, const plot_file_entry_t& entry) const;
+  map<string, plot_file_index_t> mPlotFileIndexCache; // plotFileName, index
   int32_t mWindowOffsetY{};
 
   unordered_map<string, unordered_map<string, unique_ptr<TObject>>> mDataBuffer;
   map<string, vector<string>> mInputFiles; // inputFileIdentifier, inputFilePaths
+  unordered_map<string, unordered_map<string, string>> mDataOrigin; // inputFileIdentifier, dataName, inputFilePath
+  unordered_map<string, int64_t> mInputFileTimes;                  // inputFilePath, modification time of the file when its data were read
+  static int64_t GetModificationTime(const string& inputFilePath);
   void PrintBufferStatus(bool missingOnly = false) const;
-  bool FillBuffer();
-  void ReadData(TObject* folder, vector<string>& dataNames, const string& prefix, const string& suffix, const string& inputID);
-  void ReadDataCSV(const string& inputFileName, const string& graphName, const string& inputIdentifier);
+  bool FillBuffer(const set<std::pair<string, string>>& skippedData = {}); // inputID, dataName of data that are known to be missing
+
+  struct input_data_t {
+    unordered_map<string, unique_ptr<TObject>> data; // dataName, data
+    unordered_map<string, string> origin;            // dataName, inputFilePath
+    bool success{true};
+  };
+  struct input_file_pool_t; // files (and directories within them) opened once for all inputs that are read together
+  input_data_t ReadInputData(const string& inputID, const vector<string>& dataNames, input_file_pool_t& filePool);
+  vector<vector<size_t>> GetReadGroups(const vector<string>& inputIDs) const;
+  uint32_t mNumReaderThreads{1u};
+  bool mUseStreamingMode{};
+  uint64_t mMemoryBudget{}; // in bytes
+
+  // projections of multi-dimensional data shared by all plots created in one go
+  void FillProjectionCache(const vector<Plot*>& plots);
+  unique_ptr<projection_cache_t> mProjectionCache;
+  uint32_t mNumProjectionThreads{1u};
+
+  // sizes of text measured for the layout of text and legend boxes shared by all plots of the session
+  unique_ptr<text_extent_cache_t> mTextExtentCache;
+
+  // canvases (with pads) of plots that were saved already and can be re-used by plots with the same layout
+  unique_ptr<layout_pool_t> mLayoutPool;
+  string mTextExtentCacheFile;
+
+  struct key_index_entry_t {
+    string path;                      // location within the file (relative to the entry point)
+    string className;                 // as stored in key or list
+    TKey* key{};                      // key to read in case the object resides directly in a directory
+    TObject* object{};                // object in case it is part of a list that had to be read already
+    TCollection* collection{};        // list that currently owns the object
+  };
+  using key_index_t = unordered_map<string, vector<key_index_entry_t>>; // name, entries (ordered by precedence)
+  bool BuildKeyIndex(TObject* folder, const string& path, key_index_t& keyIndex, vector<unique_ptr<TObject>>& indexedFolders, const unordered_map<string, vector<string>>* requiredData = nullptr) const;
+  TObject* ReadFromKeyIndex(key_index_t& keyIndex, const string& path, const string& name) const;
+  unique_ptr<TFileCacheRead> PrefetchKeys(TFile& file, const key_index_t& keyIndex, const unordered_map<string, vector<string>>& requiredData) const;
+
+  // persistent version of the key index (names and locations only) that can be cached between runs
+  struct file_index_t {
+    int64_t modificationTime{};
+    uintmax_t fileSize{};
+    unordered_map<string, vector<string>> entries; // name, paths (ordered by precedence)
+  };
+  shared_ptr<const file_index_t> GetFileIndex(const string& inputFileName);
+  void StoreFileIndex(const string& inputFileName, const key_index_t& keyIndex);
+  string GetFileIndexName(const string& inputFileName) const;
+  const string* FindInFileIndex(const file_index_t& fileIndex, const string& path, const string& name) const;
+  TObject* ReadFromFileIndex(TObject* folder, const string& path, const string& name, map<string, TObject*>& openedFolders, vector<unique_ptr<TObject>>& ownedFolders) const;
+  TObject* OpenIndexedFolder(TObject* folder, const string& path, map<string, TObject*>& openedFolders, vector<unique_ptr<TObject>>& ownedFolders) const;
+  string mIndexCacheDirectory;
+  bool mKeepFileIndices{}; // keep indices in memory even without cache directory (while data are loaded repeatedly from the same files)
+  unordered_map<string, shared_ptr<const file_index_t>> mFileIndexCache; // inputFilePath, index
+  std::mutex mFileIndexMutex;
+  void ReadDataCSV(const string& inputFileName, const string& inputIdentifier, unordered_map<string, vector<string>>& requiredData, input_data_t& result) const;
+  map<string, csv_format_t> mCSVFormats; // inputFileIdentifier, format
 };
 
 } // end namespace SciRooPlot
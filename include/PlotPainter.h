@@ -20,6 +20,10 @@
 #define PlotGenerator_h
 
 #include "Plot.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <mutex>
 class TH1;
 class TH2;
 class TGraph;
@@ -97,6 +101,46 @@ const map<drawing_options_t, string> defaultDrawingOptions_Graph{
   {brackets, "[]"},
 };
 
+//**************************************************************************************************
+/**
+ * Projections of multi-dimensional data that can be shared between plots.
+ */
+//**************************************************************************************************
+struct projection_cache_t {
+  using key_t = tuple<const TObject*, vector<uint8_t>, vector<tuple<uint8_t, double_t, double_t>>, bool, bool>; // source, dims, ranges, isUserCoord, isProfile
+  map<key_t, unique_ptr<TObject>> projections;
+  std::mutex mutex; // projections of different sources may be computed concurrently
+  void Release(const TObject* source);
+  void Clear();
+};
+
+//**************************************************************************************************
+/**
+ * Measured sizes of text that can be re-used by all plots of a session and stored on disk.
+ */
+//**************************************************************************************************
+struct text_extent_cache_t {
+  using key_t = tuple<string, int16_t, float_t, int32_t, int32_t>; // text, font, size, pad width and height (pixel)
+  map<key_t, tuple<uint32_t, uint32_t>> extents;                  // width, height (pixel)
+  bool isModified{};
+  bool Load(const string& fileName);
+  void Save(const string& fileName) const;
+};
+
+//**************************************************************************************************
+/**
+ * Canvases (including their pads) that can be re-used for plots with the same canvas and pad layout.
+ */
+//**************************************************************************************************
+struct layout_pool_t {
+  unordered_map<string, vector<unique_ptr<TCanvas>>> canvases; // layout, canvases ready for re-use
+  size_t nCanvases{};
+  size_t maxCanvases{16u};
+  unique_ptr<TCanvas> Acquire(const string& layout);
+  void Release(const string& layout, unique_ptr<TCanvas> canvas);
+  void Clear();
+};
+
 //**************************************************************************************************
 /**
  * Class that contains functionality to generate plots using the ROOT framework.
@@ -105,27 +149,84 @@ const map<drawing_options_t, string> defaultDrawingOptions_Graph{
 class PlotPainter
 {
 public:
+  PlotPainter(bool borrowData = false, projection_cache_t* projectionCache = nullptr, text_extent_cache_t* textExtentCache = nullptr, layout_pool_t* layoutPool = nullptr)
+    : mBorrowData{borrowData},
+      mProjectionCache{(projectionCache) ? projectionCache : &mOwnProjectionCache},
+      mTextExtentCache{(textExtentCache) ? textExtentCache : &mOwnTextExtentCache},
+      mLayoutPool{layoutPool} {}
+  ~PlotPainter();
   unique_ptr<TCanvas> GeneratePlot(Plot& plot, const unordered_map<string, unordered_map<string, unique_ptr<TObject>>>& dataBuffer);
+  bool UpdateData(TCanvas& canvas, const Plot& plot, const unordered_map<string, unordered_map<string, unique_ptr<TObject>>>& dataBuffer);
+  void RecycleCanvas(unique_ptr<TCanvas> canvas); // hand back canvas generated last once it is no longer needed
+  TObject* GetCachedProjection(TObject* obj, const Plot::Pad::Data::proj_info_t& projInfo);
 
 private:
   optional<data_ptr_t> GetDataClone(TObject* obj, const optional<Plot::Pad::Data::proj_info_t>& projInfo = nullopt);
   template <typename T>
-  optional<data_ptr_t> GetDataClone(TObject* obj);
+  optional<data_ptr_t> GetDataClone(TObject* obj, bool borrow = false);
   template <typename T, typename Next, typename... Rest>
-  optional<data_ptr_t> GetDataClone(TObject* obj);
+  optional<data_ptr_t> GetDataClone(TObject* obj, bool borrow = false);
+  optional<data_ptr_t> GetDataView(TObject* obj);
+  bool RequiresDataClone(const Plot::Pad::Data& data, const TObject* obj, uint16_t dataIndex, const string& drawingOptions) const;
+  template <typename T>
+  void BorrowData(T data_ptr);
+  template <typename BoxType>
+  void MakePrivate(shared_ptr<BoxType>& box);
   optional<data_ptr_t> GetProjection(TObject* obj, Plot::Pad::Data::proj_info_t projInfo);
 
   void SetGraphRange(TGraph* graph, optional<double_t> min, optional<double_t> max);
   void ScaleGraph(TGraph* graph, double_t scale);
   void SmoothGraph(TGraph* graph, optional<double_t> min = nullopt, optional<double_t> = nullopt);
   void SmoothHist(TH1* hist, optional<double_t> min = nullopt, optional<double_t> max = nullopt);
+
+  // level-of-detail decimation to the pixel columns of the frame
+  struct pixel_columns_t {
+    int32_t n{};
+    double_t min{};   // lower edge of the visible range (log10 for logarithmic axes)
+    double_t width{}; // range covered by one column
+    bool isLog{};
+    int64_t operator()(double_t x) const
+    {
+      if (isLog) {
+        if (x <= 0.) return std::numeric_limits<int64_t>::min();
+        x = std::log10(x);
+      }
+      return static_cast<int64_t>(std::floor(std::clamp((x - min) / width, -1e15, 1e15)));
+    }
+  };
+  static pixel_columns_t GetPixelColumns(TPad* pad, TH1* axisHist);
+  template <typename Value, typename Low, typename High>
+  static void SelectExtrema(int32_t first, int32_t last, Value value, Low low, High high, vector<int32_t>& selected);
+  void DecimateGraph(TGraph* graph, const pixel_columns_t& columns);
+  void DecimateHist(TH1* hist, const pixel_columns_t& columns);
   bool DivideGraphs(TGraph* numerator, TGraph* denominator);
   void DivideGraphsInterpolated(TGraph* numerator, TGraph* denominator);
   void DivideHistosInterpolated(TH1* numerator, TH1* denominator);
   void DivideHistGraphInterpolated(TH1* numerator, TGraph* denominator);
   void DivideGraphHistInterpolated(TGraph* numerator, TH1* denominator);
+
+  // contiguous kernels used for all ratios
+  struct points_t {
+    vector<double_t> x;
+    vector<double_t> y;
+    vector<double_t> eyLow;
+    vector<double_t> eyHigh;
+  };
+  struct error_arrays_t {
+    double_t* low{};  // both point to the same array in case of symmetric errors
+    double_t* high{};
+  };
+  void DivideInterpolated(int32_t nPoints, const double_t* x, double_t* values, error_arrays_t errors, points_t denominator);
+  void DivideArrays(int32_t nPoints, double_t* values, error_arrays_t errors, const double_t* denomValues, const double_t* denomErrorsLow, const double_t* denomErrorsHigh);
+  static vector<double_t*> GetErrorArrays(TGraph* graph);
+  static error_arrays_t GetErrorsY(TGraph* graph);
+  static points_t GetPoints(TGraph* graph);
+  static points_t GetPoints(TH1* hist);
+  static void SetPoints(TH1* hist, const points_t& points);
+  bool CopyContent(TObject* target, const TObject* source, double_t scale);
+  string GetLayout(Plot& plot);
   tuple<uint32_t, uint32_t> GetTextDimensions(TLatex& text, TPad* pad);
-  void ReplacePlaceholders(string& str, TNamed* data_ptr);
+  string FillPlaceholders(const label_template_t& labelTemplate, TNamed* data_ptr);
   TPave* GenerateBox(variant<shared_ptr<Plot::Pad::LegendBox>, shared_ptr<Plot::Pad::TextBox>> box, TPad* pad);
   float_t GetTextSizePixel(float_t textSizeNDC);
 
@@ -134,6 +235,24 @@ private:
   string GetAxisStr(int16_t i);
 
   vector<int16_t> GenerateGradientColors(int32_t nColors, const vector<tuple<float_t, float_t, float_t, float_t>>& rgbEndpoints, float_t alpha = 1., bool savePalette = false);
+  static int16_t GetTransparentColor(int16_t color, float_t opacity);
+
+  bool mBorrowData{false};                            // draw unmodified data directly from the buffer instead of copying them
+  set<const TObject*> mBorrowedData;                  // buffered data currently drawn in the plot
+  vector<std::function<void()>> mRestoreBorrowedData; // restores the original state of the borrowed data
+  map<std::pair<uint8_t, uint16_t>, TObject*> mDrawnData; // padID, dataIndex (0 is the axis frame) -> data drawn in the last generated canvas
+  set<const void*> mPrivateBoxes;                     // boxes of the current plot that were copied from the plot definition
+  struct hist_statistics_t {
+    double_t integral{};
+    double_t mean{};
+  };
+  map<const TObject*, hist_statistics_t> mUndecimatedStatistics; // decimated histograms of the current plot, statistics before decimation
+  projection_cache_t mOwnProjectionCache;              // used in case no shared cache is provided
+  projection_cache_t* mProjectionCache{};
+  text_extent_cache_t mOwnTextExtentCache;            // used in case no shared cache is provided
+  text_extent_cache_t* mTextExtentCache{};
+  layout_pool_t* mLayoutPool{};
+  string mLayout; // layout of the canvas generated last (empty if it cannot be re-used)
 };
 } // end namespace SciRooPlot
 #endif /* PlotGenerator_h */
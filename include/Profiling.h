@@ -0,0 +1,131 @@
+/*
+********************************************************************************
+* --------------------------------- SciRooPlot ---------------------------------
+* Copyright (c) 2019-2023 Mario Krüger
+* Contact: mario.kruger@cern.ch
+* For a full list of contributors please see doc/CONTRIBUTORS.md.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation in version 3 (or later) of the License.
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+* See the GNU General Public License for more details.
+* The GNU General Public License can be found here: <http://www.gnu.org/licenses/>.
+*******************************************************************************
+*/
+
+#ifndef Profiling_h
+#define Profiling_h
+
+#include "SciRooPlot.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace SciRooPlot
+{
+//**************************************************************************************************
+/**
+ * Collects timing and memory information of the individual processing phases.
+ * It is enabled via the environment variable SCIROOPLOT_TRACE=<file.json> or via PlotManager::SetTraceFile.
+ * The events are exported as Chrome/Perfetto trace and summarized in a table.
+ */
+//**************************************************************************************************
+class Profiler
+{
+public:
+  struct event_t {
+    string category;
+    string name;
+    string detail;
+    int64_t start{};    // us since start of the profiler
+    int64_t duration{}; // us, negative for counters
+    int64_t value{};    // rss difference (kB) for timed events, value for counters
+    int32_t pid{};
+    uint32_t tid{};
+  };
+
+  static Profiler& Instance();
+  static bool IsEnabled() { return sIsEnabled.load(std::memory_order_relaxed); }
+
+  void Enable(const string& traceFileName);
+  int64_t GetTime() const;
+  static int64_t GetResidentMemory();
+  static uint32_t GetThreadID();
+  void AddEvent(event_t&& event);
+  void Count(const string& name, int64_t value);
+
+  void SaveEvents(const string& fileName) const; // intermediate format used to collect the events of worker processes
+  bool LoadEvents(const string& fileName);
+  void Finish() const; // write trace file and print summary
+
+private:
+  Profiler();
+  void WriteTrace(const string& fileName) const;
+  void PrintSummary() const;
+
+  inline static std::atomic<bool> sIsEnabled{false};
+  std::chrono::steady_clock::time_point mStartTime;
+  string mTraceFileName;
+  mutable std::mutex mMutex;
+  vector<event_t> mEvents;
+};
+
+//**************************************************************************************************
+/**
+ * Records the time and memory difference between construction and destruction.
+ */
+//**************************************************************************************************
+class ScopedTimer
+{
+public:
+  ScopedTimer(const char* category, const char* name, string detail = {})
+  {
+    if (!Profiler::IsEnabled()) return;
+    mCategory = category;
+    mName = name;
+    mDetail = std::move(detail);
+    mStart = Profiler::Instance().GetTime();
+    mResidentMemory = Profiler::GetResidentMemory();
+  }
+  ~ScopedTimer()
+  {
+    if (!mCategory) return;
+    Profiler& profiler = Profiler::Instance();
+    profiler.AddEvent({mCategory, mName, std::move(mDetail), mStart, profiler.GetTime() - mStart, Profiler::GetResidentMemory() - mResidentMemory, 0, Profiler::GetThreadID()});
+  }
+  ScopedTimer(const ScopedTimer& other) = delete;
+  ScopedTimer& operator=(const ScopedTimer& other) = delete;
+
+private:
+  const char* mCategory{};
+  const char* mName{};
+  string mDetail;
+  int64_t mStart{};
+  int64_t mResidentMemory{};
+};
+} // end namespace SciRooPlot
+
+// the detail string is only evaluated when profiling is enabled
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(category, name) \
+  SciRooPlot::ScopedTimer PROFILE_CONCAT(scopedTimer_, __LINE__)(category, name)
+#define PROFILE_SCOPE_DETAIL(category, name, detail) \
+  SciRooPlot::ScopedTimer PROFILE_CONCAT(scopedTimer_, __LINE__)(category, name, (SciRooPlot::Profiler::IsEnabled()) ? string(detail) : string())
+#define PROFILE_COUNT(name, value)                                                            \
+  {                                                                                           \
+    if (SciRooPlot::Profiler::IsEnabled()) SciRooPlot::Profiler::Instance().Count(name, value); \
+  }
+
+#ifdef DISABLE_PROFILING
+#undef PROFILE_SCOPE
+#define PROFILE_SCOPE(category, name) ;
+#undef PROFILE_SCOPE_DETAIL
+#define PROFILE_SCOPE_DETAIL(category, name, detail) ;
+#undef PROFILE_COUNT
+#define PROFILE_COUNT(name, value) ;
+#endif
+#endif /* Profiling_h */
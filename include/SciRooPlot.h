@@ -50,6 +50,10 @@ using std::variant;
 using std::vector;
 
 const string gNameGroupSeparator = "_IN_";
+const string gManifestFileName = ".SciRooPlotManifest.xml";
+const string gFileIndexHeader = "# SciRooPlot file index v1";
+const string gTextExtentCacheHeader = "# SciRooPlot text extents v1";
+const string gPlotFileIndexHeader = "# SciRooPlot plot definition index v2";
 
 } // end namespace SciRooPlot
 #endif /* SciRooPlot_h */
@@ -50,6 +50,20 @@ vector<string> split_string(const string& argString, char delimiter, bool onlyFi
   return arguments;
 }
 
+// input files may be followed by a sub-directory within the file (file.root:sub/dir)
+// for remote files the colons of protocol and port (root://host:1094//path/file.root) are not considered
+vector<string> split_input_file_path(const string& inputFilePath)
+{
+  size_t pathStart = 0;
+  if (is_remote_file(inputFilePath)) {
+    pathStart = inputFilePath.find('/', inputFilePath.find("://") + 3);
+    if (pathStart == string::npos) return {inputFilePath};
+  }
+  auto delimiterPos = inputFilePath.find(':', pathStart);
+  if (delimiterPos == string::npos || delimiterPos + 1 == inputFilePath.size()) return {inputFilePath.substr(0, delimiterPos)};
+  return {inputFilePath.substr(0, delimiterPos), inputFilePath.substr(delimiterPos + 1)};
+}
+
 bool file_exists(const string& name)
 {
   struct stat buffer;
@@ -78,7 +78,7 @@ Plot::Plot(const ptree& plotTree)
     mFigureGroup = plotTree.get<string>("figure_group");
   } catch (...) {
     ERROR("Could not construct data from ptree.");
-    std::exit(EXIT_FAILURE);
+    throw; // incomplete definitions are skipped by the caller
   }
   read_from_tree(plotTree, mFigureCategory, "figure_category");
   read_from_tree(plotTree, mPlotTemplateName, "plot_template_name");
@@ -1121,6 +1121,7 @@ Plot::Pad::Data::Data(const string& name, const string& inputIdentifier, const o
   mType = "data";
 
   mLegend.label = legendLabel;
+  if (legendLabel) mLegend.labelTemplate = label_template_t::Compile(*legendLabel);
 
   // in case input was specified further via inputIdentifier:some/path/in/file
   auto subPathPos = inputIdentifier.find(":");
@@ -1147,10 +1148,11 @@ Plot::Pad::Data::Data(const ptree& dataTree) : Data()
     mInputIdentifier = dataTree.get<string>("inputIdentifier");
   } catch (...) {
     ERROR("Could not construct data from ptree.");
-    std::exit(EXIT_FAILURE);
+    throw; // incomplete definitions are skipped by the caller
   }
   if (auto var = dataTree.get_optional<bool>("defines_frame")) mDefinesFrame = *var;
   read_from_tree(dataTree, mLegend.label, "legend_label");
+  if (mLegend.label) mLegend.labelTemplate = label_template_t::Compile(*mLegend.label);
   read_from_tree(dataTree, mLegend.identifier, "legend_id");
   read_from_tree(dataTree, mDrawingOptions, "drawing_options");
   read_from_tree(dataTree, mDrawingOptionAlias, "drawing_option_alias");
@@ -1166,6 +1168,7 @@ Plot::Pad::Data::Data(const ptree& dataTree) : Data()
   read_from_tree(dataTree, mFill.scale, "fill_opacity");
   read_from_tree(dataTree, mModify.scaleFactor, "scale_factor");
   read_from_tree(dataTree, mModify.normMode, "norm_mode");
+  read_from_tree(dataTree, mModify.decimate, "decimate");
   read_from_tree(dataTree, mRangeX.min, "rangeX_min");
   read_from_tree(dataTree, mRangeX.max, "rangeX_max");
   read_from_tree(dataTree, mRangeY.min, "rangeY_min");
@@ -1218,6 +1221,7 @@ ptree Plot::Pad::Data::GetPropertyTree() const
   put_in_tree(dataTree, mFill.scale, "fill_opacity");
   put_in_tree(dataTree, mModify.scaleFactor, "scale_factor");
   put_in_tree(dataTree, mModify.normMode, "norm_mode");
+  put_in_tree(dataTree, mModify.decimate, "decimate");
   put_in_tree(dataTree, mRangeX.min, "rangeX_min");
   put_in_tree(dataTree, mRangeX.max, "rangeX_max");
   put_in_tree(dataTree, mRangeY.min, "rangeY_min");
@@ -1301,6 +1305,7 @@ auto Plot::Pad::Data::SetInputID(const string& inputIdentifier) -> decltype(*thi
 auto Plot::Pad::Data::SetLegendLabel(const string& legendLabel) -> decltype(*this)
 {
   mLegend.label = legendLabel;
+  mLegend.labelTemplate = label_template_t::Compile(legendLabel);
   return *this;
 }
 auto Plot::Pad::Data::SetLegendID(uint8_t legendID) -> decltype(*this)
@@ -1339,6 +1344,11 @@ auto Plot::Pad::Data::SetNormalize(bool useWidth) -> decltype(*this)
   mModify.normMode = useWidth;
   return *this;
 }
+auto Plot::Pad::Data::SetDecimation(bool decimate) -> decltype(*this)
+{
+  mModify.decimate = decimate;
+  return *this;
+}
 auto Plot::Pad::Data::SetRangeX(double_t min, double_t max) -> decltype(*this)
 {
   mRangeX.min = min;
@@ -2346,9 +2356,11 @@ Plot::Pad::LegendBox& Plot::Pad::LegendBox::SetDefaultFillOpacity(float_t opacit
  * Add entry to LegendBox.
  */
 //**************************************************************************************************
-Plot::Pad::LegendBox::LegendEntry& Plot::Pad::LegendBox::AddEntry(const string& label, const string& refDataName)
+Plot::Pad::LegendBox::LegendEntry& Plot::Pad::LegendBox::AddEntry(const string& label, const string& refDataName, const shared_ptr<const label_template_t>& labelTemplate)
 {
-  mLegendEntries.push_back(LegendEntry(label, refDataName));
+  mLegendEntries.push_back(LegendEntry(nullopt, refDataName));
+  mLegendEntries.back().mLabel = label;
+  mLegendEntries.back().mLabelTemplate = labelTemplate; // was already compiled for the data
   return mLegendEntries.back();
 }
 
@@ -2378,6 +2390,7 @@ void Plot::Pad::LegendBox::MergeLegendEntries()
 Plot::Pad::LegendBox::LegendEntry::LegendEntry(const optional<string>& label, const optional<string>& refDataName, const optional<string>& drawStyle)
 {
   mLabel = label;
+  if (label) mLabelTemplate = label_template_t::Compile(*label);
   mRefDataName = refDataName;
   mDrawStyle = drawStyle;
 }
@@ -2390,6 +2403,7 @@ Plot::Pad::LegendBox::LegendEntry::LegendEntry(const optional<string>& label, co
 Plot::Pad::LegendBox::LegendEntry::LegendEntry(const ptree& legendEntryTree)
 {
   read_from_tree(legendEntryTree, mLabel, "label");
+  if (mLabel) mLabelTemplate = label_template_t::Compile(*mLabel);
   read_from_tree(legendEntryTree, mRefDataName, "ref_data_name");
   read_from_tree(legendEntryTree, mDrawStyle, "draw_style");
   read_from_tree(legendEntryTree, mFill.color, "fill_color");
@@ -2464,6 +2478,7 @@ void Plot::Pad::LegendBox::LegendEntry::operator+=(
 Plot::Pad::LegendBox::LegendEntry& Plot::Pad::LegendBox::LegendEntry::SetLabel(const string& label)
 {
   mLabel = label;
+  mLabelTemplate = label_template_t::Compile(label);
   return *this;
 }
 
@@ -2557,4 +2572,72 @@ Plot::Pad::LegendBox::LegendEntry& Plot::Pad::LegendBox::LegendEntry::SetTextSiz
 template class Plot::Pad::Box<Plot::Pad::TextBox>;
 template class Plot::Pad::Box<Plot::Pad::LegendBox>;
 //**************************************************************************************************
+//**************************************************************************************************
+/**
+ * Splits label into literal text and placeholders. As before, a placeholder starts with '<' followed by one of the
+ * characters of the supported keywords and ends with the next '>'. An optional format can be given in brackets.
+ */
+//**************************************************************************************************
+shared_ptr<const label_template_t> label_template_t::Compile(const string& label)
+{
+  static const string placeholderStartChars{"name,title,entries,integral,mean,maximum,minimum"};
+  static const vector<std::pair<string, placeholder_t>> keywords{
+    {"name", placeholder_t::name},
+    {"title", placeholder_t::title},
+    {"entries", placeholder_t::entries},
+    {"integral", placeholder_t::integral},
+    {"mean", placeholder_t::mean},
+    {"maximum", placeholder_t::maximum},
+    {"minimum", placeholder_t::minimum},
+  };
+  if (label.find('<') == string::npos) return nullptr;
+
+  auto labelTemplate = std::make_shared<label_template_t>();
+  string literal;
+  size_t pos{};
+  while (pos < label.size()) {
+    size_t start = label.find('<', pos);
+    size_t end = (start == string::npos || start + 2 > label.size()) ? string::npos : label.find('>', start + 2);
+    if (end == string::npos) {
+      literal += label.substr(pos);
+      break;
+    }
+    if (placeholderStartChars.find(label[start + 1]) == string::npos) {
+      literal += label.substr(pos, start + 1 - pos);
+      pos = start + 1;
+      continue;
+    }
+    string original = label.substr(start, end + 1 - start);
+    literal += label.substr(pos, start - pos);
+    pos = end + 1;
+
+    auto keyword = std::find_if(keywords.begin(), keywords.end(), [&original](auto& curKeyword) { return str_contains(original, curKeyword.first); });
+    if (keyword == keywords.end()) {
+      literal += original;
+      continue;
+    }
+
+    // check if user specified different formatting (e.g. via <mean[%2.6]>)
+    string format;
+    if (auto formatStart = original.find('['); formatStart != string::npos) {
+      if (auto formatEnd = original.find(']', formatStart); formatEnd != string::npos) {
+        format = original.substr(formatStart + 1, formatEnd - formatStart - 1);
+      }
+    }
+    // allow printf style and protect against wrong usage
+    format.erase(remove(format.begin(), format.end(), '%'), format.end());
+    format.erase(remove(format.begin(), format.end(), ' '), format.end());
+
+    // if no valid formatting pattern is given, fall back to 'general' mode
+    if (format.find_first_of("efgEFG") == string::npos) {
+      format = format + "g";
+    }
+    labelTemplate->tokens.push_back({std::move(literal), keyword->second, "{:" + format + "}", std::move(original)});
+    literal.clear();
+  }
+  if (labelTemplate->tokens.empty()) return nullptr;
+  if (!literal.empty()) labelTemplate->tokens.push_back({std::move(literal), placeholder_t::none, "", ""});
+  return labelTemplate;
+}
+
 } // end namespace SciRooPlot
@@ -21,11 +21,32 @@
 #include "PlotPainter.h"
 #include "Logging.h"
 #include "Helpers.h"
+#include "Profiling.h"
 
 // std dependencies
 #include <regex>
 #include <filesystem>
 #include <limits>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <numeric>
+#include <functional>
+#include <cstdio>
+#include <charconv>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 // boost dependencies
 #include <boost/property_tree/xml_parser.hpp>
@@ -36,11 +57,14 @@
 #include "TSystem.h"
 #include "TError.h"
 #include "TFile.h"
+#include "TFileCacheRead.h"
 #include "TRootCanvas.h"
 #include "TCanvas.h"
 #include "TKey.h"
 #include "TH1.h"
 #include "TGraphErrors.h"
+#include "TGraph2D.h"
+#include "THn.h"
 #include "TFolder.h"
 #include "TPave.h"
 
@@ -52,7 +76,7 @@ namespace SciRooPlot
  * Constructor for PlotManager.
  */
 //**************************************************************************************************
-PlotManager::PlotManager() : mApp(new TApplication("MainApp", 0, nullptr)), mOutputFileName("ResultPlots.root")
+PlotManager::PlotManager() : mApp(new TApplication("MainApp", 0, nullptr)), mOutputFileName("ResultPlots.root"), mProjectionCache(new projection_cache_t), mTextExtentCache(new text_extent_cache_t), mLayoutPool(new layout_pool_t)
 {
   TQObject::Connect("TGMainFrame", "CloseWindow()", "TApplication", gApplication, "Terminate()");
   gErrorIgnoreLevel = kWarning;
@@ -73,38 +97,212 @@ PlotManager::PlotManager() : mApp(new TApplication("MainApp", 0, nullptr)), mOut
 //**************************************************************************************************
 PlotManager::~PlotManager()
 {
-  if (mSaveToRootFile) SavePlotsToFile();
+  WaitForPendingOutputs();
+  ClosePDFBook();
+  CloseOutputFile();
+  Profiler::Instance().Finish();
 }
 
 //**************************************************************************************************
 /**
- * Save stored plots to .root file.
+ * Output file for the "file" mode. It is created once the first plot is saved and replaces any existing file.
  */
 //**************************************************************************************************
-void PlotManager::SavePlotsToFile() const
+TFile* PlotManager::GetOutputFile()
 {
-  if (!mPlotLedger.empty()) {
-    TFile outputFile((mOutputDirectory + "/" + mOutputFileName).data(), "RECREATE");
-    if (outputFile.IsZombie()) {
+  if (!mOutputFile) {
+    string fileName = mOutputDirectory + "/" + ((mNumShards > 1) ? GetShardFileName(mOutputFileName, mShardID, mNumShards) : mOutputFileName);
+    {
+      // opening the file makes it the current directory, where e.g. histograms cloned by the painter would end up
+      TDirectory::TContext context;
+      mOutputFile.reset(new TFile(fileName.data(), "RECREATE"));
+    }
+    if (mOutputFile->IsZombie()) {
+      ERROR("Cannot create output file {}.", fileName);
+      mOutputFile.reset();
+      return nullptr;
+    }
+    mNumPlotsInOutputFile = 0u;
+  }
+  return mOutputFile.get();
+}
+
+//**************************************************************************************************
+/**
+ * Directory (figure group and category) and name of a plot within the output file.
+ */
+//**************************************************************************************************
+std::pair<string, string> PlotManager::GetOutputLocation(const string& uniqueName)
+{
+  size_t delimiterPos = uniqueName.find(gNameGroupSeparator.data());
+  string plotName = uniqueName.substr(0, delimiterPos);
+  string subfolder = uniqueName.substr(delimiterPos + gNameGroupSeparator.size());
+  std::replace(subfolder.begin(), subfolder.end(), ':', '/');
+  return {subfolder, plotName};
+}
+
+//**************************************************************************************************
+/**
+ * Write canvas to its figure group and category directory in the output file.
+ * The directory structure and the keys are flushed to disk regularly, such that an aborted run still leaves a readable file.
+ */
+//**************************************************************************************************
+bool PlotManager::WriteToOutputFile(const string& uniqueName, TCanvas& canvas)
+{
+  PROFILE_SCOPE_DETAIL("output", "WriteToOutputFile", uniqueName);
+  constexpr uint32_t flushInterval{100u};
+  TFile* outputFile = GetOutputFile();
+  if (!outputFile) return false;
+  auto [subfolder, plotName] = GetOutputLocation(uniqueName);
+  TDirectory* directory = outputFile->GetDirectory(subfolder.data());
+  if (!directory) {
+    outputFile->mkdir(subfolder.data());
+    directory = outputFile->GetDirectory(subfolder.data());
+  }
+  if (!directory || directory->WriteTObject(&canvas, plotName.data(), "Overwrite") <= 0) {
+    ERROR("Cannot write plot {} to file {}.", uniqueName, mOutputFileName);
+    return false;
+  }
+  if (++mNumPlotsInOutputFile % flushInterval == 0) {
+    outputFile->WriteStreamerInfo();
+    outputFile->Write();
+    outputFile->Flush();
+  }
+  return true;
+}
+
+//**************************************************************************************************
+/**
+ * Finalize the output file of the "file" mode.
+ */
+//**************************************************************************************************
+void PlotManager::CloseOutputFile()
+{
+  if (!mOutputFile) return;
+  PROFILE_SCOPE("output", "CloseOutputFile");
+  mOutputFile->Close();
+  mOutputFile.reset();
+  INFO("Saved {} plots to file {}.", mNumPlotsInOutputFile, mOutputFileName);
+}
+
+//**************************************************************************************************
+/**
+ * Save canvas to file. In asynchronous mode the encoding and writing is done by a helper process that works on a copy of the canvas,
+ * while this process continues with the next plot. The number of helper processes running at the same time is limited.
+ */
+//**************************************************************************************************
+void PlotManager::SaveCanvas(TCanvas& canvas, const string& fileName, bool isAsync)
+{
+  PROFILE_SCOPE_DETAIL("output", "SaveAs", fileName);
+  if (isAsync) {
+    WaitForPendingOutputs(mMaxPendingOutputs - 1);
+    // buffered output would otherwise be duplicated in the helper process
+    std::cout.flush();
+    std::fflush(nullptr);
+    pid_t pid = fork();
+    if (pid == 0) {
+      canvas.SaveAs(fileName.data());
+      std::cout.flush();
+      std::fflush(nullptr);
+      std::_Exit(EXIT_SUCCESS);
+    }
+    if (pid > 0) {
+      mPendingOutputs.push_back({pid, fileName});
       return;
     }
-    outputFile.cd();
-    uint32_t nPlots{0u};
-    for (auto& [uniqueName, canvas] : mPlotLedger) {
-      size_t delimiterPos = uniqueName.find(gNameGroupSeparator.data());
-      string plotName = uniqueName.substr(0, delimiterPos);
-      string subfolder = uniqueName.substr(delimiterPos + gNameGroupSeparator.size());
-      std::replace(subfolder.begin(), subfolder.end(), ':', '/');
-      if (!outputFile.GetDirectory(subfolder.data(), kFALSE, "cd")) {
-        outputFile.mkdir(subfolder.data());
-      }
-      outputFile.cd(subfolder.data());
-      canvas->Write(plotName.data());
-      ++nPlots;
+    WARNING("Could not start helper process. Saving {} directly.", fileName);
+  }
+  canvas.SaveAs(fileName.data());
+}
+
+//**************************************************************************************************
+/**
+ * Wait until at most the specified number of output files are still being written.
+ */
+//**************************************************************************************************
+void PlotManager::WaitForPendingOutputs(size_t maxPendingOutputs)
+{
+  while (mPendingOutputs.size() > maxPendingOutputs) {
+    PROFILE_SCOPE("output", "WaitForPendingOutputs");
+    auto [pid, fileName] = mPendingOutputs.front();
+    mPendingOutputs.pop_front();
+    int32_t status{};
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+      ERROR("Writing {} did not finish successfully.", fileName);
+    }
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Create output directory (including parents). Directories created already during this call of CreatePlots are remembered.
+ */
+//**************************************************************************************************
+void PlotManager::CreateOutputDirectory(const string& folderName)
+{
+  if (mCreatedDirectories.find(folderName) != mCreatedDirectories.end()) return;
+  std::error_code errorCode;
+  std::filesystem::create_directories(folderName, errorCode);
+  if (errorCode) {
+    ERROR("Cannot create output directory {} ({}).", folderName, errorCode.message());
+    return;
+  }
+  mCreatedDirectories.insert(folderName);
+}
+
+//**************************************************************************************************
+/**
+ * Append canvas as new page to the pdf book. The currently open book is finished once a plot belongs to another book.
+ * Each page gets a bookmark with the plot name.
+ */
+//**************************************************************************************************
+void PlotManager::AddToPDFBook(TCanvas& canvas, const string& bookName, const Plot& plot)
+{
+  PROFILE_SCOPE_DETAIL("output", "AddToPDFBook", bookName);
+  if (bookName != mPDFBookName) {
+    ClosePDFBook();
+    mPDFBookName = bookName;
+    LOG("Saving pdf book {}", bookName);
+    // open the file without printing a page, such that fonts and other resources are shared by all pages
+    canvas.Print((bookName + "[").data());
+  }
+  canvas.Print(bookName.data(), ("Title:" + plot.GetName()).data());
+  mPDFBookPages.push_back({plot.GetName(), plot.GetUniqueName()});
+}
+
+//**************************************************************************************************
+/**
+ * Finish the currently open pdf book and store the index of its pages next to it (<book>.pages.txt),
+ * which can be used to extract individual plots (e.g. via 'qpdf book.pdf --pages . 3 -- plot.pdf').
+ */
+//**************************************************************************************************
+void PlotManager::ClosePDFBook()
+{
+  if (mPDFBookName.empty()) return;
+  PROFILE_SCOPE_DETAIL("output", "ClosePDFBook", mPDFBookName);
+  {
+    TCanvas closingCanvas("closingCanvas", "closingCanvas", 1, 1);
+    closingCanvas.Print((mPDFBookName + "]").data());
+  }
+
+  string indexFileName = std::filesystem::path(mPDFBookName).replace_extension(".pages.txt").string();
+  string tmpFileName = indexFileName + ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream indexFile(tmpFileName);
+    indexFile << "# page\tplot\tunique name\n";
+    for (size_t page = 0; page < mPDFBookPages.size(); ++page) {
+      indexFile << page + 1 << '\t' << mPDFBookPages[page].first << '\t' << mPDFBookPages[page].second << '\n';
     }
-    outputFile.Close();
-    INFO("Saved {} plots to file {}.", nPlots, mOutputFileName);
   }
+  std::error_code errorCode;
+  std::filesystem::rename(tmpFileName, indexFileName, errorCode);
+  if (errorCode) {
+    ERROR("Cannot write page index {}.", indexFileName);
+    std::filesystem::remove(tmpFileName, errorCode);
+  }
+  INFO("Saved {} plot{} to pdf book {}.", mPDFBookPages.size(), (mPDFBookPages.size() == 1) ? "" : "s", mPDFBookName);
+  mPDFBookName.clear();
+  mPDFBookPages.clear();
 }
 
 //**************************************************************************************************
@@ -114,9 +312,60 @@ void PlotManager::SavePlotsToFile() const
 //**************************************************************************************************
 void PlotManager::ClearDataBuffer()
 {
+  mProjectionCache->Clear();
   mDataBuffer.clear();
+  mDataOrigin.clear();
+  mInputFileTimes.clear();
 };
 
+//**************************************************************************************************
+/**
+ * Removes data from the buffer whose input file was modified since the data were read, such that they are read again
+ * once they are needed. All other data stay in memory.
+ */
+//**************************************************************************************************
+void PlotManager::ClearOutdatedData()
+{
+  set<string> modifiedFiles;
+  for (auto it = mInputFileTimes.begin(); it != mInputFileTimes.end();) {
+    if (GetModificationTime(it->first) != it->second) {
+      modifiedFiles.insert(it->first);
+      it = mInputFileTimes.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (modifiedFiles.empty()) return;
+
+  uint32_t nOutdatedData{};
+  for (auto& [inputID, origins] : mDataOrigin) {
+    auto input = mDataBuffer.find(inputID);
+    for (auto it = origins.begin(); it != origins.end();) {
+      if (modifiedFiles.find(it->second) == modifiedFiles.end()) {
+        ++it;
+        continue;
+      }
+      if (input != mDataBuffer.end()) nOutdatedData += input->second.erase(it->first);
+      it = origins.erase(it);
+    }
+  }
+  mProjectionCache->Clear();
+  INFO("Released {} data from {} modified input file{}.", nOutdatedData, modifiedFiles.size(), (modifiedFiles.size() == 1) ? "" : "s");
+}
+
+//**************************************************************************************************
+/**
+ * Modification time of an input file (the path may contain a sub-directory after ':'), 0 if it does not exist.
+ */
+//**************************************************************************************************
+int64_t PlotManager::GetModificationTime(const string& inputFilePath)
+{
+  std::error_code errorCode;
+  auto modificationTime = std::filesystem::last_write_time(split_input_file_path(inputFilePath)[0], errorCode);
+  if (errorCode) return 0;
+  return static_cast<int64_t>(modificationTime.time_since_epoch().count());
+}
+
 //**************************************************************************************************
 /**
  * Sets path for output files. Plots wil be stored in hierarchical structure according to figure groups and categories.
@@ -147,6 +396,48 @@ void PlotManager::SetOutputFileName(const string& fileName)
   mOutputFileName = fileName;
 }
 
+//**************************************************************************************************
+/**
+ * Number of worker processes that share the creation of plots in the batch modes (pdf, png, eps, svg, file).
+ */
+//**************************************************************************************************
+void PlotManager::SetNumWorkers(uint32_t numWorkers)
+{
+  mNumWorkers = std::max(numWorkers, 1u);
+}
+
+//**************************************************************************************************
+/**
+ * Hand over the encoding and writing of pdf, png, eps and svg files to helper processes, such that painting the next plot does not have to wait for it.
+ * At most maxPendingOutputs files are written at the same time.
+ */
+//**************************************************************************************************
+void PlotManager::SetUseAsyncOutput(bool useAsyncOutput, uint32_t maxPendingOutputs)
+{
+  mUseAsyncOutput = useAsyncOutput;
+  mMaxPendingOutputs = std::max(maxPendingOutputs, 1u);
+}
+
+//**************************************************************************************************
+/**
+ * Number of threads used to read the data of different inputs concurrently.
+ */
+//**************************************************************************************************
+void PlotManager::SetNumReaderThreads(uint32_t numThreads)
+{
+  mNumReaderThreads = std::max(numThreads, 1u);
+}
+
+//**************************************************************************************************
+/**
+ * Number of threads used to compute projections of different input data concurrently.
+ */
+//**************************************************************************************************
+void PlotManager::SetNumProjectionThreads(uint32_t numThreads)
+{
+  mNumProjectionThreads = std::max(numThreads, 1u);
+}
+
 //**************************************************************************************************
 /**
  * Define input file paths for user defined unique inputIdentifier.
@@ -165,6 +456,22 @@ void PlotManager::AddInputDataFile(const string& inputIdentifier, const string&
   AddInputDataFiles(inputIdentifier, inputFilePathList);
 }
 
+//**************************************************************************************************
+/**
+ * Define delimiter and column layout of the csv files belonging to an input identifier.
+ */
+//**************************************************************************************************
+void PlotManager::SetCSVFormat(const string& inputIdentifier, const csv_format_t& format)
+{
+  for (auto& graph : format.graphs) {
+    if (graph.name.empty() || graph.name.find('/') != string::npos) {
+      ERROR("Invalid graph name '{}' in csv format of input {}.", graph.name, inputIdentifier);
+      return;
+    }
+  }
+  mCSVFormats[inputIdentifier] = format;
+}
+
 //**************************************************************************************************
 /**
  * Dump input file identifiers and paths that are currently defined in the manager to a config file.
@@ -178,6 +485,23 @@ void PlotManager::DumpInputDataFiles(const string& configFileName) const
     for (auto& fileName : inFileTuple.second) {
       filesOfIdentifier.add("FILE", fileName);
     }
+    if (auto it = mCSVFormats.find(inFileTuple.first); it != mCSVFormats.end()) {
+      const csv_format_t& format = it->second;
+      ptree formatTree;
+      formatTree.put("delimiter", (format.delimiter == '\t') ? string("tab") : (format.delimiter == ' ') ? string("space") : string(1, format.delimiter));
+      formatTree.put("comment", string(1, format.comment));
+      formatTree.put("skip_lines", format.skipLines);
+      for (auto& graph : format.graphs) {
+        ptree graphTree;
+        graphTree.put("name", graph.name);
+        graphTree.put("x", graph.x);
+        graphTree.put("y", graph.y);
+        if (graph.ex) graphTree.put("ex", *graph.ex);
+        if (graph.ey) graphTree.put("ey", *graph.ey);
+        formatTree.add_child("GRAPH", graphTree);
+      }
+      filesOfIdentifier.put_child("CSV_FORMAT", formatTree);
+    }
     inputFileTree.put_child(inFileTuple.first, filesOfIdentifier);
   }
   using boost::property_tree::xml_writer_settings;
@@ -206,12 +530,28 @@ void PlotManager::LoadInputDataFiles(const string& configFileName)
     const string& inputIdentifier = inputPair.first;
     set<string> allFileNames;
     for (auto& fileEntry : inputPair.second) {
+      if (fileEntry.first == "CSV_FORMAT") {
+        csv_format_t format;
+        string delimiter = fileEntry.second.get<string>("delimiter", "tab");
+        format.delimiter = (delimiter == "tab") ? '\t' : (delimiter == "space") ? ' ' : delimiter.front();
+        format.comment = fileEntry.second.get<string>("comment", "#").front();
+        format.skipLines = fileEntry.second.get<uint32_t>("skip_lines", 0u);
+        for (auto& [key, graphTree] : fileEntry.second) {
+          if (key != "GRAPH") continue;
+          csv_graph_t graph{graphTree.get<string>("name", ""), graphTree.get<uint8_t>("x", 0u), graphTree.get<uint8_t>("y", 1u), {}, {}};
+          read_from_tree(graphTree, graph.ex, "ex");
+          read_from_tree(graphTree, graph.ey, "ey");
+          format.graphs.push_back(graph);
+        }
+        SetCSVFormat(inputIdentifier, format);
+        continue;
+      }
       string fileOrDirName = expand_path(fileEntry.second.get_value<string>());
-      if (str_contains(fileOrDirName, ".root", true) || str_contains(fileOrDirName, ".csv", true)) {
+      if (str_contains(fileOrDirName, ".root", true) || str_contains(fileOrDirName, ".csv", true) || str_contains(fileOrDirName, ".tsv", true)) {
         allFileNames.insert(fileOrDirName);
       } else if (std::filesystem::is_directory(fileOrDirName)) {
         for (auto& file : std::filesystem::recursive_directory_iterator(fileOrDirName)) {
-          if (file.path().extension() == ".root" || file.path().extension() == ".csv") {
+          if (file.path().extension() == ".root" || file.path().extension() == ".csv" || file.path().extension() == ".tsv") {
             allFileNames.insert(file.path().string());
           }
         }
@@ -221,6 +561,17 @@ void PlotManager::LoadInputDataFiles(const string& configFileName)
   }
 }
 
+//**************************************************************************************************
+/**
+ * Record the time and memory spent in the individual phases and write them as Chrome/Perfetto trace to this file.
+ * Profiling can also be enabled via the environment variable SCIROOPLOT_TRACE.
+ */
+//**************************************************************************************************
+void PlotManager::SetTraceFile(const string& fileName)
+{
+  Profiler::Instance().Enable(fileName);
+}
+
 //**************************************************************************************************
 /**
  * Add pre-defined plot to the manager. Plot will be moved and no longer accessible from outside the manager.
@@ -231,16 +582,45 @@ void PlotManager::AddPlot(Plot& plot)
   if (plot.GetFigureGroup() == "PLOT_TEMPLATES") {
     ERROR("You cannot use reserved group name 'PLOT_TEMPLATES'!");
   }
-  mPlots.erase(std::remove_if(mPlots.begin(), mPlots.end(),
-                              [plot](Plot& curPlot) mutable {
-                                bool removePlot = curPlot.GetUniqueName() == plot.GetUniqueName();
-                                if (removePlot) WARNING("Plot {} in {} already exists and will be replaced.", curPlot.GetName(), curPlot.GetFigureGroup());
-                                return removePlot;
-                              }),
-               mPlots.end());
+  if (auto it = mPlotIndex.find(plot.GetUniqueName()); it != mPlotIndex.end()) {
+    WARNING("Plot {} in {} already exists and will be replaced.", plot.GetName(), plot.GetFigureGroup());
+    mPlots[it->second] = std::move(plot);
+    return;
+  }
+  mPlotIndex[plot.GetUniqueName()] = mPlots.size();
+  mPlotsPerGroup[plot.GetFigureGroup()].push_back(mPlots.size());
   mPlots.push_back(std::move(plot));
 }
 
+//**************************************************************************************************
+/**
+ * Add many pre-defined plots to the manager at once. Plots will be moved and no longer accessible from outside the manager.
+ */
+//**************************************************************************************************
+void PlotManager::AddPlots(vector<Plot>&& plots)
+{
+  mPlots.reserve(mPlots.size() + plots.size());
+  for (auto& plot : plots) {
+    AddPlot(plot);
+  }
+  plots.clear();
+}
+
+//**************************************************************************************************
+/**
+ * Remove all plots and plot templates from the manager. Input data stay buffered.
+ */
+//**************************************************************************************************
+void PlotManager::ClearPlots()
+{
+  mPlots.clear();
+  mPlotIndex.clear();
+  mPlotsPerGroup.clear();
+  mPlotTemplates.clear();
+  mPlotTemplateIndex.clear();
+  mPlotTemplateHashes.clear();
+}
+
 //**************************************************************************************************
 /**
  * Add template for plots, that share some common properties.
@@ -249,13 +629,13 @@ void PlotManager::AddPlot(Plot& plot)
 void PlotManager::AddPlotTemplate(Plot& plotTemplate)
 {
   plotTemplate.SetFigureGroup("PLOT_TEMPLATES");
-  mPlotTemplates.erase(std::remove_if(mPlotTemplates.begin(), mPlotTemplates.end(),
-                                      [plotTemplate](Plot& curPlotTemplate) mutable {
-                                        bool removePlot = curPlotTemplate.GetUniqueName() == plotTemplate.GetUniqueName();
-                                        if (removePlot) WARNING("Plot template {} already exists and will be replaced.", curPlotTemplate.GetName());
-                                        return removePlot;
-                                      }),
-                       mPlotTemplates.end());
+  mPlotTemplateHashes.erase(plotTemplate.GetName());
+  if (auto it = mPlotTemplateIndex.find(plotTemplate.GetName()); it != mPlotTemplateIndex.end()) {
+    WARNING("Plot template {} already exists and will be replaced.", plotTemplate.GetName());
+    mPlotTemplates[it->second] = std::move(plotTemplate);
+    return;
+  }
+  mPlotTemplateIndex[plotTemplate.GetName()] = mPlotTemplates.size();
   mPlotTemplates.push_back(std::move(plotTemplate));
 }
 
@@ -308,22 +688,201 @@ void PlotManager::DumpPlot(const string& plotFileName, const string& figureGroup
 
 //**************************************************************************************************
 /**
- * Read and cache plots defined in xml file.
+ * Provides the index of the plot definitions in xml file. The index is kept in the index cache directory
+ * (see SetIndexCacheDirectory) and re-built whenever the file was modified.
  */
 //**************************************************************************************************
-ptree& PlotManager::ReadPlotTemplatesFromFile(const string& plotFileName)
+const PlotManager::plot_file_index_t* PlotManager::GetPlotFileIndex(const string& plotFileName)
 {
-  if (mPropertyTreeCache.find(plotFileName) == mPropertyTreeCache.end()) {
-    try {
-      using boost::property_tree::read_xml;
-      read_xml(expand_path(plotFileName), mPropertyTreeCache[plotFileName]);
-      INFO("Reading plot definitions from {}.", plotFileName);
-    } catch (...) {
+  string fileName = expand_path(plotFileName);
+  std::error_code errorCode;
+  int64_t modificationTime = std::filesystem::last_write_time(fileName, errorCode).time_since_epoch().count();
+  uintmax_t fileSize = (errorCode) ? 0u : std::filesystem::file_size(fileName, errorCode);
+  if (errorCode) {
+    ERROR("Cannot load file {}.", plotFileName);
+    return nullptr;
+  }
+
+  auto cachedIndex = mPlotFileIndexCache.find(fileName);
+  if (cachedIndex != mPlotFileIndexCache.end() && cachedIndex->second.modificationTime == modificationTime && cachedIndex->second.fileSize == fileSize) {
+    return &cachedIndex->second;
+  }
+
+  plot_file_index_t plotFileIndex;
+  // without cache directory the index is only kept for this session
+  string indexFileName = (mIndexCacheDirectory.empty()) ? "" : mIndexCacheDirectory + "/" + std::to_string(std::hash<string>{}(fileName)) + ".plots.idx";
+  std::ifstream indexFile;
+  if (!indexFileName.empty()) indexFile.open(indexFileName);
+  string line;
+  bool isValid = (indexFile && std::getline(indexFile, line) && line == gPlotFileIndexHeader);
+  isValid = isValid && std::getline(indexFile, line) && line == fileName;
+  isValid = isValid && (indexFile >> plotFileIndex.modificationTime >> plotFileIndex.fileSize);
+  isValid = isValid && plotFileIndex.modificationTime == modificationTime && plotFileIndex.fileSize == fileSize;
+  if (isValid) {
+    std::getline(indexFile, line);
+    while (std::getline(indexFile, line)) {
+      std::istringstream entryStream(line);
+      plot_file_entry_t entry;
+      if (!(entryStream >> entry.offset >> entry.length) || entryStream.get() != '\t') continue;
+      std::getline(entryStream, entry.group, '\t');
+      std::getline(entryStream, entry.category, '\t');
+      std::getline(entryStream, entry.name);
+      plotFileIndex.entries.push_back(std::move(entry));
+    }
+  } else {
+    INFO("Indexing plot definitions in {}.", plotFileName);
+    plotFileIndex = {};
+    plotFileIndex.modificationTime = modificationTime;
+    plotFileIndex.fileSize = fileSize;
+    if (!BuildPlotFileIndex(fileName, plotFileIndex)) {
       ERROR("Cannot load file {}.", plotFileName);
-      std::exit(EXIT_FAILURE);
+      return nullptr;
+    }
+    if (!indexFileName.empty()) {
+      std::filesystem::create_directories(mIndexCacheDirectory, errorCode);
+      // write to temporary file first so concurrent runs never see incomplete indices
+      string tmpFileName = indexFileName + "." + std::to_string(getpid());
+      {
+        std::ofstream newIndexFile(tmpFileName);
+        if (newIndexFile) {
+          newIndexFile << gPlotFileIndexHeader << "\n"
+                       << fileName << "\n"
+                       << plotFileIndex.modificationTime << " " << plotFileIndex.fileSize << "\n";
+          for (auto& entry : plotFileIndex.entries) {
+            newIndexFile << entry.offset << " " << entry.length << "\t" << entry.group << "\t" << entry.category << "\t" << entry.name << "\n";
+          }
+        }
+      }
+      std::filesystem::rename(tmpFileName, indexFileName, errorCode);
+      if (errorCode) std::filesystem::remove(tmpFileName, errorCode); // index is then only kept for this session
+    }
+  }
+  INFO("Reading plot definitions from {}.", plotFileName);
+  return &(mPlotFileIndexCache[fileName] = std::move(plotFileIndex));
+}
+
+//**************************************************************************************************
+/**
+ * Locates the plot definitions within the xml file and extracts group, category and name of each plot.
+ * Groups are the top-level elements of the file and contain the plots as direct children.
+ */
+//**************************************************************************************************
+bool PlotManager::BuildPlotFileIndex(const string& plotFileName, plot_file_index_t& plotFileIndex) const
+{
+  std::ifstream plotFile(plotFileName, std::ios::binary);
+  if (!plotFile) return false;
+  std::stringstream buffer;
+  buffer << plotFile.rdbuf();
+  const string content = buffer.str();
+
+  int32_t depth{};
+  string group;
+  size_t plotStart{};
+  size_t pos{};
+  while ((pos = content.find('<', pos)) != string::npos) {
+    if (content.compare(pos, 4, "<!--") == 0) {
+      pos = content.find("-->", pos);
+      if (pos == string::npos) return false;
+      pos += 3;
+      continue;
+    }
+    // find end of tag while ignoring '>' within attribute values
+    size_t end = pos + 1;
+    char quote{};
+    for (; end < content.size(); ++end) {
+      char c = content[end];
+      if (quote) {
+        if (c == quote) quote = 0;
+      } else if (c == '"' || c == '\'') {
+        quote = c;
+      } else if (c == '>') {
+        break;
+      }
+    }
+    if (end >= content.size()) return false;
+
+    char type = content[pos + 1];
+    bool isClosing = (type == '/');
+    bool isSelfClosing = (content[end - 1] == '/');
+    if (type == '?' || type == '!') {
+      // declaration or processing instruction
+    } else if (isClosing) {
+      --depth;
+      if (depth == 1) {
+        plot_file_entry_t entry{plotStart, end + 1 - plotStart, group, "", ""};
+        std::istringstream plotStream(content.substr(plotStart, entry.length));
+        std::istream& plotInput = plotStream;
+        ptree plotTree;
+        try {
+          plotTree = ReadPlotDefinition(plotInput, {0u, entry.length});
+        } catch (...) {
+          return false;
+        }
+        entry.name = plotTree.get<string>("name", "");
+        entry.category = plotTree.get<string>("figure_category", "");
+        plotFileIndex.entries.push_back(std::move(entry));
+      }
+    } else if (!isSelfClosing) {
+      if (depth == 0) {
+        size_t nameEnd = content.find_first_of(" \t\r\n/>", pos + 1);
+        group = content.substr(pos + 1, nameEnd - pos - 1);
+        if (group.rfind("GROUP::", 0) == 0) group.erase(0, string("GROUP::").size());
+      } else if (depth == 1) {
+        plotStart = pos;
+      }
+      ++depth;
     }
+    pos = end + 1;
+  }
+  return (depth == 0);
+}
+
+//**************************************************************************************************
+/**
+ * Parses a single plot definition from the xml file.
+ */
+//**************************************************************************************************
+ptree PlotManager::ReadPlotDefinition(std::istream& plotFile, const plot_file_entry_t& entry) const
+{
+  string definition(entry.length, '\0');
+  plotFile.clear();
+  plotFile.seekg(entry.offset);
+  plotFile.read(definition.data(), entry.length);
+  std::istringstream definitionStream(definition);
+  ptree definitionTree;
+  using boost::property_tree::read_xml;
+  read_xml(definitionStream, definitionTree);
+  if (definitionTree.empty()) return {};
+  return definitionTree.front().second;
+}
+
+//**************************************************************************************************
+/**
+ * Combines plot with the template it is based on.
+ */
+//**************************************************************************************************
+Plot PlotManager::ResolvePlotTemplate(const Plot& plot) const
+{
+  PROFILE_SCOPE("plot", "ResolveTemplate");
+  // boxes stay shared with the definitions, the painter copies the ones it modifies
+  if (const Plot* plotTemplate = FindPlotTemplate(plot)) return *plotTemplate + plot;
+  return plot;
+}
+
+//**************************************************************************************************
+/**
+ * Looks up the template a plot is based on (nullptr if it does not use a template).
+ */
+//**************************************************************************************************
+const Plot* PlotManager::FindPlotTemplate(const Plot& plot) const
+{
+  if (!plot.GetPlotTemplateName()) return nullptr;
+  const string& plotTemplateName = *plot.GetPlotTemplateName();
+  if (auto it = mPlotTemplateIndex.find(plotTemplateName); it != mPlotTemplateIndex.end()) {
+    return &mPlotTemplates[it->second];
   }
-  return mPropertyTreeCache[plotFileName];
+  WARNING("Could not find plot template named {}.", plotTemplateName);
+  return nullptr;
 }
 
 //**************************************************************************************************
@@ -333,95 +892,24 @@ ptree& PlotManager::ReadPlotTemplatesFromFile(const string& plotFileName)
 //**************************************************************************************************
 bool PlotManager::GeneratePlot(const Plot& plot, const string& outputMode)
 {
-  // if plot already exists, delete the old one first
-  if (mPlotLedger.find(plot.GetUniqueName()) != mPlotLedger.end()) {
-    ERROR("Plot {} was already created. Replacing it.", plot.GetUniqueName());
-    mPlotLedger.erase(plot.GetUniqueName());
-  }
+  PROFILE_SCOPE_DETAIL("plot", "GeneratePlot", plot.GetUniqueName());
   if (plot.GetFigureGroup().empty()) {
     ERROR("No figure group was specified for plot {}.", plot.GetName());
     return false;
   }
-  if (outputMode == "file") {
-    mSaveToRootFile = true;
-  }
-  Plot fullPlot = plot;
-  if (plot.GetPlotTemplateName()) {
-    const string& plotTemplateName = *plot.GetPlotTemplateName();
-    auto iterator = std::find_if(
-      mPlotTemplates.begin(), mPlotTemplates.end(),
-      [&](Plot& plotTemplate) { return plotTemplate.GetName() == plotTemplateName; });
-    if (iterator != mPlotTemplates.end()) {
-      fullPlot = *iterator + plot;
-    } else {
-      WARNING("Could not find plot template named {}.", plotTemplateName);
-    }
-  }
-  PlotPainter painter;
-  bool isInteractiveMode = (outputMode == "interactive");
+  Plot fullPlot = ResolvePlotTemplate(plot);
   bool isMacroMode = (outputMode == "macro");
-  gROOT->SetBatch(!isInteractiveMode && !isMacroMode);
-  shared_ptr<TCanvas> canvas{painter.GeneratePlot(fullPlot, mDataBuffer)};
+  PlotPainter painter(true, mProjectionCache.get(), mTextExtentCache.get(), mLayoutPool.get());
+  gROOT->SetBatch(!isMacroMode);
+  unique_ptr<TCanvas> canvas{painter.GeneratePlot(fullPlot, mDataBuffer)};
   if (!canvas) return false;
   if (TColor::GetFreeColorIndex() > std::numeric_limits<int16_t>::max()) {
     // there is a natural limit to the number of custom colors since ROOT color indices are of type short
-    ERROR("Too many custom colors in one session. Aborting...");
-    std::exit(EXIT_FAILURE);
+    ERROR("Too many custom colors in one session. Cannot create plot {}.", plot.GetName());
+    return false;
   }
   LOG("Created " GREEN_ "{}" _END " from group " YELLOW_ "{}" _END ".", fullPlot.GetName(), fullPlot.GetFigureGroup() + ((fullPlot.GetFigureCategory()) ? "/" + *fullPlot.GetFigureCategory() : ""));
 
-  // if interactive mode is specified, open window instead of saving the plot
-  if (isInteractiveMode) {
-    mPlotLedger[plot.GetUniqueName()] = canvas;
-    mPlotViewHistory.push_back(&plot.GetUniqueName());
-    uint32_t curPlotIndex{static_cast<uint32_t>(mPlotViewHistory.size() - 1)};
-
-    // move new canvas to position of previous window
-    int32_t curXpos{};
-    int32_t curYpos{};
-    if (curPlotIndex > 0) {
-      curXpos = mPlotLedger[*mPlotViewHistory[curPlotIndex - 1]]->GetWindowTopX();
-      curYpos = mPlotLedger[*mPlotViewHistory[curPlotIndex - 1]]->GetWindowTopY();
-      canvas->SetWindowPosition(curXpos, curYpos - mWindowOffsetY);
-      static_cast<TRootCanvas*>(mPlotLedger[*mPlotViewHistory[curPlotIndex - 1]]->GetCanvasImp())->UnmapWindow();
-    }
-    canvas->Show();
-    bool boxClicked = false;
-    while (!gSystem->ProcessEvents() && gROOT->GetSelectedPad()) {
-      bool isClick = canvas->GetEvent() == kButton1Double;
-      bool isValidKey = canvas->GetEvent() == kKeyPress && (canvas->GetEventX() == 'a' || canvas->GetEventX() == 's');
-      auto selectedBox = dynamic_cast<TPave*>(canvas->GetSelected());
-      if (isClick && selectedBox) {
-        if (!boxClicked) INFO("Current position of {}: ({:.3g}, {:.3g}).", selectedBox->GetName(), selectedBox->GetX1NDC(), selectedBox->GetY2NDC());
-        boxClicked = true;
-      } else if (isClick || isValidKey) {
-        curXpos = canvas->GetWindowTopX();
-        curYpos = canvas->GetWindowTopY();
-        bool forward = false;
-        if (isValidKey) {
-          forward = (canvas->GetEventX() == 's');
-        } else {
-          forward = ((double_t)canvas->GetEventX() / (double_t)canvas->GetWw() > 0.5);
-        }
-        if (forward) {
-          if (curPlotIndex == mPlotViewHistory.size() - 1) break;
-          ++curPlotIndex;
-        } else {
-          if (curPlotIndex == 0) std::exit(EXIT_FAILURE);
-          --curPlotIndex;
-        }
-        static_cast<TRootCanvas*>(canvas->GetCanvasImp())->UnmapWindow();
-        canvas = mPlotLedger[*mPlotViewHistory[curPlotIndex]];
-        canvas->SetWindowPosition(curXpos, curYpos - mWindowOffsetY);
-        canvas->Show();
-      } else {
-        boxClicked = false;
-      }
-      gSystem->Sleep(20);
-    }
-    return true;
-  }
-
   if (mOutputDirectory.empty()) {
     ERROR("No output directory was specified. Cannot save plot.");
     return true;
@@ -433,21 +921,27 @@ bool PlotManager::GeneratePlot(const Plot& plot, const string& outputMode)
   }
 
   if (outputMode == "file") {
-    mPlotLedger[plot.GetUniqueName()] = canvas;
+    bool isWritten = WriteToOutputFile(plot.GetUniqueName(), *canvas);
+    painter.RecycleCanvas(std::move(canvas));
+    return isWritten;
+  }
+
+  string fullName = GetOutputFileName(plot, outputMode);
+  if (fullName.empty()) {
+    ERROR("No valid output format was specified. Cannot save plot.");
     return true;
   }
+  string folderName = std::filesystem::path(fullName).parent_path().string();
 
-  bool isGif = false;
-  static string gifName;
-  static string gifFolderName;
+  bool isGif = str_contains(outputMode, "gif");
   string gifRepRate = "+50"; // number of centiseconds between frames
+  if (isGif) {
+    if (auto delimPos = outputMode.find("+"); delimPos != string::npos) {
+      gifRepRate = outputMode.substr(delimPos);
+    }
+  }
 
-  string fileEnding;
-  if (outputMode == "pdf") {
-    fileEnding = ".pdf";
-  } else if (isMacroMode) {
-    fileEnding = ".C";
-
+  if (isMacroMode) {
     // object names are converted to variable names and therefore must not contain '/'
     // TODO: this should be fixed in ROOT itself as it does not create valid cpp code otherwise
     std::function<void(TPad*)> cleanNames;
@@ -467,197 +961,1589 @@ bool PlotManager::GeneratePlot(const Plot& plot, const string& outputMode)
     string saveName = canvas->GetName();
     std::replace(saveName.begin(), saveName.end(), '/', '_');
     canvas->SetName(saveName.data());
+  }
 
-  } else if (outputMode == "png") {
-    fileEnding = ".png";
-  } else if (outputMode == "eps") {
-    fileEnding = ".eps";
-  } else if (outputMode == "svg") {
-    fileEnding = ".svg";
-  } else if (str_contains(outputMode, "gif")) {
-    fileEnding = ".gif";
-    isGif = true;
-    if (auto delimPos = outputMode.find("+"); delimPos != string::npos) {
-      gifRepRate = outputMode.substr(delimPos);
+  // create output folders and files
+  if (isGif) {
+    if (mGifName.empty()) {
+      gSystem->Unlink(fullName.data());
+      LOG("Saving gif {}", fullName);
+      fullName += gifRepRate;
+      mGifName = fullName;
+      mGifFolderName = folderName;
+    } else {
+      fullName = mGifName;
+      folderName = mGifFolderName;
     }
   }
+  CreateOutputDirectory(folderName);
+  if (outputMode == "pdf-book") {
+    AddToPDFBook(*canvas, fullName, plot);
+  } else {
+    // gifs are appended frame by frame and therefore have to be written in order
+    SaveCanvas(*canvas, fullName, mUseAsyncOutput && !isGif && !isMacroMode);
+  }
+  // the next plot with the same layout can be drawn on the same canvas
+  painter.RecycleCanvas(std::move(canvas));
+  // reset TCandle range options to their default values after drawing data
+  TCandle::SetBoxRange(0.5);
+  TCandle::SetWhiskerRange(0.75);
+  return true;
+}
 
-  if (fileEnding.empty()) {
-    ERROR("No valid output format was specified. Cannot save plot.");
-    return true;
+//**************************************************************************************************
+/**
+ * Shows the plots one after another in a window. One can scroll through them by double clicking on the right
+ * resp. left side of the canvas or by pressing the keys 's' (forward) and 'a' (backward).
+ * Plots (and their input data) are only created once they are about to be shown: while the user is looking at a plot,
+ * its neighbours are prepared in the idle time of the event loop. Canvases far away from the current one are deleted again.
+ */
+//**************************************************************************************************
+void PlotManager::BrowsePlots(const vector<Plot*>& plots)
+{
+  if (plots.empty()) return;
+  constexpr size_t nKeptNeighbours{2u}; // on either side of the current plot
+
+  map<size_t, unique_ptr<TCanvas>> canvases; // position in plots, canvas (nullptr if plot could not be created)
+  auto getCanvas = [&](size_t plotIndex) -> TCanvas* {
+    if (auto it = canvases.find(plotIndex); it != canvases.end()) return it->second.get();
+    const Plot& plot = *plots[plotIndex];
+    PROFILE_SCOPE_DETAIL("plot", "GeneratePlot", plot.GetUniqueName());
+    for (auto& [inputID, dataName] : GetRequiredData(plot)) {
+      mDataBuffer[inputID][dataName];
+    }
+    if (!FillBuffer()) PrintBufferStatus(true);
+    Plot fullPlot = ResolvePlotTemplate(plot);
+    // canvases that are kept alive after painting must not reference the buffered data
+    PlotPainter painter(false, mProjectionCache.get(), mTextExtentCache.get());
+    gROOT->SetBatch(false);
+    auto& canvas = canvases[plotIndex];
+    canvas = painter.GeneratePlot(fullPlot, mDataBuffer);
+    if (!canvas) {
+      ERROR("Plot " GREEN_ "{}" _END " from group " YELLOW_ "{}" _END " could not be created.", plot.GetName(), plot.GetFigureGroup() + ((plot.GetFigureCategory()) ? "/" + *plot.GetFigureCategory() : ""));
+      return nullptr;
+    }
+    if (TColor::GetFreeColorIndex() > std::numeric_limits<int16_t>::max()) {
+      ERROR("Too many custom colors in one session. Aborting...");
+      std::exit(EXIT_FAILURE);
+    }
+    LOG("Created " GREEN_ "{}" _END " from group " YELLOW_ "{}" _END ".", fullPlot.GetName(), fullPlot.GetFigureGroup() + ((fullPlot.GetFigureCategory()) ? "/" + *fullPlot.GetFigureCategory() : ""));
+    return canvas.get();
+  };
+
+  // plots that could not be created are skipped
+  auto findPlot = [&](size_t plotIndex, bool forward) -> optional<size_t> {
+    while (true) {
+      if (getCanvas(plotIndex)) return plotIndex;
+      if (forward && plotIndex + 1 >= plots.size()) return nullopt;
+      if (!forward && plotIndex == 0) return nullopt;
+      plotIndex = (forward) ? plotIndex + 1 : plotIndex - 1;
+    }
+  };
+
+  optional<size_t> curPlotIndex = findPlot(0u, true);
+  if (!curPlotIndex) return;
+  TCanvas* canvas = getCanvas(*curPlotIndex);
+  canvas->Show();
+  canvas->cd();
+  bool boxClicked = false;
+  while (!gSystem->ProcessEvents() && gROOT->GetSelectedPad()) {
+    bool isClick = canvas->GetEvent() == kButton1Double;
+    bool isValidKey = canvas->GetEvent() == kKeyPress && (canvas->GetEventX() == 'a' || canvas->GetEventX() == 's');
+    auto selectedBox = dynamic_cast<TPave*>(canvas->GetSelected());
+    if (isClick && selectedBox) {
+      if (!boxClicked) INFO("Current position of {}: ({:.3g}, {:.3g}).", selectedBox->GetName(), selectedBox->GetX1NDC(), selectedBox->GetY2NDC());
+      boxClicked = true;
+    } else if (isClick || isValidKey) {
+      int32_t curXpos = canvas->GetWindowTopX();
+      int32_t curYpos = canvas->GetWindowTopY();
+      bool forward = false;
+      if (isValidKey) {
+        forward = (canvas->GetEventX() == 's');
+      } else {
+        forward = ((double_t)canvas->GetEventX() / (double_t)canvas->GetWw() > 0.5);
+      }
+      optional<size_t> newPlotIndex;
+      if (forward && *curPlotIndex + 1 < plots.size()) newPlotIndex = findPlot(*curPlotIndex + 1, true);
+      if (!forward && *curPlotIndex > 0) newPlotIndex = findPlot(*curPlotIndex - 1, false);
+      if (!newPlotIndex) {
+        if (forward) break;
+        std::exit(EXIT_FAILURE);
+      }
+      static_cast<TRootCanvas*>(canvas->GetCanvasImp())->UnmapWindow();
+      curPlotIndex = newPlotIndex;
+      canvas = getCanvas(*curPlotIndex);
+      canvas->SetWindowPosition(curXpos, curYpos - mWindowOffsetY);
+      canvas->Show();
+      canvas->cd();
+      for (auto it = canvases.begin(); it != canvases.end();) {
+        bool isFarAway = (it->first + nKeptNeighbours < *curPlotIndex || it->first > *curPlotIndex + nKeptNeighbours);
+        it = (isFarAway) ? canvases.erase(it) : std::next(it);
+      }
+    } else {
+      boxClicked = false;
+      // use the idle time to prepare the plots that are likely to be shown next
+      optional<size_t> nextPlotIndex;
+      if (*curPlotIndex + 1 < plots.size() && canvases.find(*curPlotIndex + 1) == canvases.end()) {
+        nextPlotIndex = *curPlotIndex + 1;
+      } else if (*curPlotIndex > 0 && canvases.find(*curPlotIndex - 1) == canvases.end()) {
+        nextPlotIndex = *curPlotIndex - 1;
+      }
+      if (nextPlotIndex) {
+        getCanvas(*nextPlotIndex);
+        canvas->cd();
+        continue;
+      }
+    }
+    gSystem->Sleep(20);
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Determines the name of the output file for modes that save each plot to a separate file
+ * (for "pdf-book" the file shared by all plots of the figure group and category).
+ * Returns empty string for all other modes.
+ */
+//**************************************************************************************************
+string PlotManager::GetOutputFileName(const Plot& plot, const string& outputMode) const
+{
+  string fileEnding;
+  if (outputMode == "pdf") {
+    fileEnding = ".pdf";
+  } else if (outputMode == "macro") {
+    fileEnding = ".C";
+  } else if (outputMode == "png") {
+    fileEnding = ".png";
+  } else if (outputMode == "eps") {
+    fileEnding = ".eps";
+  } else if (outputMode == "svg") {
+    fileEnding = ".svg";
+  } else if (str_contains(outputMode, "gif")) {
+    fileEnding = ".gif";
+  }
+  if (outputMode == "pdf-book") {
+    string bookName = mOutputDirectory + "/" + plot.GetFigureGroup();
+    if (plot.GetFigureCategory()) bookName += "/" + *plot.GetFigureCategory();
+    return bookName + ".pdf";
   }
+  if (fileEnding.empty()) return "";
 
   string fileName = (mUseUniquePlotNames) ? plot.GetUniqueName() : plot.GetName();
   std::replace(fileName.begin(), fileName.end(), '/', '_');
 
-  // create output folders and files
   string folderName = mOutputDirectory + "/" + plot.GetFigureGroup();
   if (plot.GetFigureCategory()) folderName += "/" + *plot.GetFigureCategory();
-  string fullName = folderName + "/" + fileName + fileEnding;
+  return folderName + "/" + fileName + fileEnding;
+}
 
-  if (isGif) {
-    if (gifName.empty()) {
-      gSystem->Unlink(fullName.data());
-      LOG("Saving gif {}", fullName);
-      fullName += gifRepRate;
-      gifName = fullName;
-      gifFolderName = folderName;
-    } else {
-      fullName = gifName;
-      folderName = gifFolderName;
+//**************************************************************************************************
+/**
+ * Creates plots.
+ */
+//**************************************************************************************************
+void PlotManager::CreatePlots(const string& figureGroup, const string& figureCategory,
+                              vector<string> plotNames, const string& outputMode)
+{
+  // look up the candidates in the index instead of scanning all plots
+  vector<size_t> candidates;
+  if (!figureGroup.empty() && !figureCategory.empty() && !plotNames.empty()) {
+    for (auto& plotName : plotNames) {
+      if (auto it = mPlotIndex.find(plotName + gNameGroupSeparator + figureGroup + "/" + figureCategory); it != mPlotIndex.end()) {
+        candidates.push_back(it->second);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end()); // keep the order in which the plots were added
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  } else if (!figureGroup.empty()) {
+    if (auto it = mPlotsPerGroup.find(figureGroup); it != mPlotsPerGroup.end()) candidates = it->second;
+  } else {
+    candidates.resize(mPlots.size());
+    std::iota(candidates.begin(), candidates.end(), 0u);
+  }
+
+  set<string> requestedPlotNames(plotNames.begin(), plotNames.end());
+  vector<Plot*> selectedPlots;
+  for (size_t slot : candidates) {
+    Plot& plot = mPlots[slot];
+    if (!figureCategory.empty() && !(plot.GetFigureCategory() && *plot.GetFigureCategory() == figureCategory)) {
+      continue;
+    } else if (!plotNames.empty() && requestedPlotNames.find(plot.GetName()) == requestedPlotNames.end()) {
+      continue;
+    }
+    selectedPlots.push_back(&plot);
+  }
+  set<string> foundPlotNames;
+  for (Plot* plot : selectedPlots) {
+    foundPlotNames.insert(plot->GetName());
+  }
+  plotNames.erase(std::remove_if(plotNames.begin(), plotNames.end(),
+                                 [&](const string& plotName) { return foundPlotNames.find(plotName) != foundPlotNames.end(); }),
+                  plotNames.end());
+
+  // were definitions for all requested plots available?
+  if (!plotNames.empty()) {
+    for (auto& plotName : plotNames) {
+      WARNING("Could not find plot " GREEN_ "{}" _END " in group " YELLOW_ "{}" _END ".", plotName, figureGroup + ((!figureCategory.empty()) ? "/" + figureCategory : ""));
+    }
+  }
+  CreateSelectedPlots(std::move(selectedPlots), outputMode);
+}
+
+//**************************************************************************************************
+/**
+ * Creates the selected plots in the specified output mode.
+ */
+//**************************************************************************************************
+void PlotManager::CreateSelectedPlots(vector<Plot*> selectedPlots, const string& outputMode)
+{
+  mCreatedDirectories.clear();
+  if (mNumShards > 1) {
+    size_t nPlots = selectedPlots.size();
+    selectedPlots = GetShardPlots(selectedPlots, outputMode);
+    INFO("Shard {}/{} creates {} of {} plot{}.", mShardID, mNumShards, selectedPlots.size(), nPlots, (nPlots == 1) ? "" : "s");
+  }
+
+  // in incremental mode only plots whose definition or input data changed are re-created
+  bool isBookMode = (outputMode == "pdf-book");
+  bool isIncrementalMode = (mUseIncrementalMode && !GetOutputFileName(Plot(), outputMode).empty() && !str_contains(outputMode, "gif") && !isBookMode);
+  if (mUseIncrementalMode && !isIncrementalMode) WARNING("Incremental mode is not available for mode {}. All plots will be created.", outputMode);
+  map<const Plot*, size_t> definitionHashes;
+  set<string> shardOutputFiles;
+  if (isIncrementalMode) {
+    LoadManifest();
+    if (mNumShards > 1) {
+      for (auto plot : selectedPlots) {
+        shardOutputFiles.insert(GetOutputFileName(*plot, outputMode));
+      }
+    }
+    uint32_t nSkippedPlots{};
+    selectedPlots.erase(std::remove_if(selectedPlots.begin(), selectedPlots.end(),
+                                       [&](Plot* plot) {
+                                         size_t definitionHash = GetDefinitionHash(*plot);
+                                         definitionHashes[plot] = definitionHash;
+                                         bool isUpToDate = IsUpToDate(GetOutputFileName(*plot, outputMode), definitionHash);
+                                         if (isUpToDate) ++nSkippedPlots;
+                                         return isUpToDate;
+                                       }),
+                        selectedPlots.end());
+    if (nSkippedPlots > 0) INFO("Skipping {} plot{} that {} up to date.", nSkippedPlots, (nSkippedPlots == 1) ? "" : "s", (nSkippedPlots == 1) ? "is" : "are");
+  }
+
+  // the times of files lag behind the clock, so the start of the run is taken from a file that is touched now
+  auto startTime = std::filesystem::file_time_type::clock::now();
+  if (isIncrementalMode) {
+    std::error_code errorCode;
+    std::filesystem::path directory = (std::filesystem::is_directory(mOutputDirectory, errorCode)) ? std::filesystem::path(mOutputDirectory) : std::filesystem::temp_directory_path(errorCode);
+    string startFileName = (directory / ("SciRooPlot_" + std::to_string(getpid()) + "_start.tmp")).string();
+    if (std::ofstream(startFileName)) {
+      auto fileTime = std::filesystem::last_write_time(startFileName, errorCode);
+      if (!errorCode) startTime = fileTime;
+      std::filesystem::remove(startFileName, errorCode);
+    }
+  }
+
+  // modes that show windows or that append to a common output file have to run sequentially
+  bool isParallelMode = (mNumWorkers > 1 && selectedPlots.size() > 1 && outputMode != "interactive" && outputMode != "macro" && !str_contains(outputMode, "gif") && !isBookMode);
+  if (isBookMode) {
+    // only one pdf file can be open at a time, so the pages of each book have to be created in one go
+    std::stable_sort(selectedPlots.begin(), selectedPlots.end(), [&](const Plot* a, const Plot* b) { return GetOutputFileName(*a, outputMode) < GetOutputFileName(*b, outputMode); });
+  }
+  if (outputMode == "interactive") {
+    BrowsePlots(selectedPlots);
+  } else if (isParallelMode) {
+    GeneratePlotsParallel(selectedPlots, outputMode);
+  } else {
+    GeneratePlots(selectedPlots, outputMode);
+  }
+  WaitForPendingOutputs();
+  ClosePDFBook();
+  // the next gif starts with a new file
+  mGifName.clear();
+  mGifFolderName.clear();
+
+  if (isIncrementalMode) {
+    for (auto plot : selectedPlots) {
+      UpdateManifest(*plot, GetOutputFileName(*plot, outputMode), definitionHashes[plot], startTime);
+    }
+    if (mNumShards > 1) {
+      // entries of plots created by other shards would be outdated once the shards are merged
+      for (auto it = mManifest.begin(); it != mManifest.end();) {
+        it = (shardOutputFiles.find(it->first) == shardOutputFiles.end()) ? mManifest.erase(it) : std::next(it);
+      }
+    }
+    SaveManifest(GetManifestFileName());
+  }
+  mProjectionCache->Clear();
+  if (!mTextExtentCacheFile.empty() && mTextExtentCache->isModified) {
+    mTextExtentCache->Save(mTextExtentCacheFile);
+    mTextExtentCache->isModified = false;
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Creates animated gif from a sweep over the data of one plot. The figure group may contain the category (group/category).
+ * Layout, axes and boxes are painted once for the first frame. For the following frames only the content of the data is
+ * exchanged, unless this is not possible (e.g. for ratios or legend labels with placeholders) and the frame is painted from scratch.
+ * Axis ranges are therefore defined by the first frame unless they are set explicitly.
+ */
+//**************************************************************************************************
+bool PlotManager::CreateAnimation(const string& figureGroup, const string& plotName, const vector<animation_frame_t>& frames, uint32_t frameDelay)
+{
+  PROFILE_SCOPE_DETAIL("plot", "CreateAnimation", plotName + gNameGroupSeparator + figureGroup);
+  auto storedPlot = mPlotIndex.find(plotName + gNameGroupSeparator + figureGroup);
+  if (storedPlot == mPlotIndex.end()) {
+    ERROR("Could not find plot " GREEN_ "{}" _END " in group " YELLOW_ "{}" _END ".", plotName, figureGroup);
+    return false;
+  }
+  if (frames.empty()) {
+    ERROR("No frames were specified for animation of plot {}.", plotName);
+    return false;
+  }
+  if (mOutputDirectory.empty()) {
+    ERROR("No output directory was specified. Cannot save animation.");
+    return false;
+  }
+
+  size_t definitionHash = GetDefinitionHash(mPlots[storedPlot->second]);
+
+  // plot definition of each frame
+  vector<Plot> framePlots;
+  framePlots.reserve(frames.size());
+  for (auto& frame : frames) {
+    Plot framePlot = ResolvePlotTemplate(mPlots[storedPlot->second]);
+    for (auto& update : frame.updates) {
+      auto pad = framePlot.GetPads().find(update.padID);
+      if (pad == framePlot.GetPads().end() || update.dataID == 0 || update.dataID > pad->second.GetData().size()) {
+        ERROR("Plot {} has no data {} in pad {}.", plotName, update.dataID, update.padID);
+        return false;
+      }
+      // the data are shared with the stored plot definition and must not be changed there
+      auto& data_ptr = pad->second.GetData()[update.dataID - 1];
+      data_ptr = data_ptr->Clone();
+      auto& data = *data_ptr;
+      if (update.name) data.mName = *update.name;
+      if (update.inputIdentifier) data.mInputIdentifier = *update.inputIdentifier;
+      if (update.projectionRanges) {
+        if (!data.mProjInfo) {
+          ERROR("Data {} in pad {} of plot {} is no projection.", update.dataID, update.padID, plotName);
+          return false;
+        }
+        data.mProjInfo->ranges = *update.projectionRanges;
+      }
+    }
+    framePlots.push_back(std::move(framePlot));
+  }
+
+  for (auto& framePlot : framePlots) {
+    for (auto& [inputID, dataName] : GetRequiredData(framePlot)) {
+      mDataBuffer[inputID][dataName];
+    }
+  }
+  if (!FillBuffer()) PrintBufferStatus(true);
+
+  string fileName = GetOutputFileName(framePlots.front(), "gif");
+  CreateOutputDirectory(std::filesystem::path(fileName).parent_path().string());
+  gSystem->Unlink(fileName.data());
+  LOG("Saving gif {}", fileName);
+  string frameFileName = fileName + "+" + std::to_string(frameDelay);
+
+  // the canvas outlives the individual frames and therefore must not borrow the buffered data
+  PlotPainter painter(false, mProjectionCache.get(), mTextExtentCache.get());
+  bool isBatch = gROOT->IsBatch();
+  gROOT->SetBatch(true);
+  unique_ptr<TCanvas> canvas;
+  uint32_t nPaintedFrames{};
+  for (size_t frameID = 0; frameID < framePlots.size(); ++frameID) {
+    PROFILE_SCOPE_DETAIL("plot", "AnimationFrame", std::to_string(frameID));
+    if (!canvas || !painter.UpdateData(*canvas, framePlots[frameID], mDataBuffer)) {
+      Plot paintedPlot = framePlots[frameID].Clone(); // the painter modifies the plot
+      canvas = painter.GeneratePlot(paintedPlot, mDataBuffer);
+      if (!canvas) {
+        ERROR("Frame {} of animation {} could not be created.", frameID, plotName);
+        gROOT->SetBatch(isBatch);
+        return false;
+      }
+      ++nPaintedFrames;
+    }
+    PROFILE_SCOPE_DETAIL("output", "SaveAs", fileName);
+    canvas->SaveAs(frameFileName.data());
+  }
+  gROOT->SetBatch(isBatch);
+  if (GetDefinitionHash(mPlots[storedPlot->second]) != definitionHash) {
+    ERROR("Definition of plot {} was modified while creating its animation.", plotName);
+  }
+  LOG("Created animation " GREEN_ "{}" _END " from group " YELLOW_ "{}" _END " with {} frames ({} painted from scratch).", plotName, figureGroup, framePlots.size(), nPaintedFrames);
+
+  // reset TCandle range options to their default values after drawing data
+  TCandle::SetBoxRange(0.5);
+  TCandle::SetWhiskerRange(0.75);
+  mProjectionCache->Clear();
+  return true;
+}
+
+//**************************************************************************************************
+/**
+ * Loads the input data for the plots and generates them one after another.
+ */
+//**************************************************************************************************
+bool PlotManager::GeneratePlots(const vector<Plot*>& plots, const string& outputMode)
+{
+  if (mUseStreamingMode) return GeneratePlotsStreaming(plots, outputMode);
+
+  // determine which input data are needed for plots
+  for (auto plot : plots) {
+    for (auto& [inputID, dataName] : GetRequiredData(*plot)) {
+      mDataBuffer[inputID][dataName];
+    }
+  }
+  if (!FillBuffer()) PrintBufferStatus(true);
+  FillProjectionCache(plots);
+
+  bool success = true;
+  for (auto plot : plots) {
+    if (!GeneratePlot(*plot, outputMode)) {
+      ERROR("Plot " GREEN_ "{}" _END " from group " YELLOW_ "{}" _END " could not be created.", plot->GetName(), plot->GetFigureGroup() + ((plot->GetFigureCategory()) ? "/" + *plot->GetFigureCategory() : ""));
+      success = false;
+    }
+  }
+  return success;
+}
+
+//**************************************************************************************************
+/**
+ * Generates plots while keeping only the input data in memory that are still needed.
+ * Plots sharing input data are created after each other. Each data is loaded right before the first plot that uses it
+ * and released after the last one. In case the buffer grows beyond the memory budget, the least recently used data are
+ * released as well and will be read again from the input files once they are needed.
+ */
+//**************************************************************************************************
+bool PlotManager::GeneratePlotsStreaming(vector<Plot*> plots, const string& outputMode)
+{
+  using data_key_t = std::pair<string, string>; // inputID, dataName
+  map<const Plot*, set<data_key_t>> requiredData;
+  map<data_key_t, uint32_t> nConsumers;
+  for (auto plot : plots) {
+    requiredData[plot] = GetRequiredData(*plot);
+    for (auto& dataKey : requiredData[plot]) {
+      ++nConsumers[dataKey];
+    }
+  }
+
+  // the order of plots matters for gifs and pdf books
+  if (!str_contains(outputMode, "gif") && outputMode != "pdf-book") {
+    std::stable_sort(plots.begin(), plots.end(), [&](const Plot* a, const Plot* b) { return requiredData[a] < requiredData[b]; });
+  }
+
+  // data that were in the buffer already before are left untouched
+  set<data_key_t> preloadedData;
+  for (auto& [inputID, buffer] : mDataBuffer) {
+    for (auto& [dataName, dataPtr] : buffer) {
+      if (dataPtr) preloadedData.insert({inputID, dataName});
+    }
+  }
+
+  std::list<data_key_t> usageHistory; // most recently used first
+  map<data_key_t, std::pair<std::list<data_key_t>::iterator, uint64_t>> loadedData; // position in history, size
+  set<data_key_t> missingData;                                                        // not found in the input files, so there is no need to search again
+  uint64_t bufferSize{};
+  auto releaseData = [&](const data_key_t& dataKey) {
+    if (preloadedData.find(dataKey) != preloadedData.end()) return;
+    if (auto it = loadedData.find(dataKey); it != loadedData.end()) {
+      bufferSize -= it->second.second;
+      usageHistory.erase(it->second.first);
+      loadedData.erase(it);
+    }
+    if (auto input = mDataBuffer.find(dataKey.first); input != mDataBuffer.end()) {
+      if (auto data = input->second.find(dataKey.second); data != input->second.end()) mProjectionCache->Release(data->second.get());
+      input->second.erase(dataKey.second);
+      if (input->second.empty()) mDataBuffer.erase(input);
+    }
+  };
+
+  // the files are opened again for every plot, so their indices are kept until all plots are created
+  bool keepFileIndices = mKeepFileIndices;
+  mKeepFileIndices = true;
+
+  bool success = true;
+  for (auto plot : plots) {
+    for (auto& [inputID, dataName] : requiredData[plot]) {
+      mDataBuffer[inputID][dataName];
+    }
+    if (!FillBuffer(missingData)) PrintBufferStatus(true);
+
+    for (auto& dataKey : requiredData[plot]) {
+      if (preloadedData.find(dataKey) != preloadedData.end()) continue;
+      if (!mDataBuffer[dataKey.first][dataKey.second]) {
+        missingData.insert(dataKey);
+        continue;
+      }
+      if (auto it = loadedData.find(dataKey); it != loadedData.end()) {
+        usageHistory.splice(usageHistory.begin(), usageHistory, it->second.first);
+      } else {
+        uint64_t dataSize = GetDataSize(mDataBuffer[dataKey.first][dataKey.second].get());
+        usageHistory.push_front(dataKey);
+        loadedData[dataKey] = {usageHistory.begin(), dataSize};
+        bufferSize += dataSize;
+      }
+    }
+
+    if (!GeneratePlot(*plot, outputMode)) {
+      ERROR("Plot " GREEN_ "{}" _END " from group " YELLOW_ "{}" _END " could not be created.", plot->GetName(), plot->GetFigureGroup() + ((plot->GetFigureCategory()) ? "/" + *plot->GetFigureCategory() : ""));
+      success = false;
+    }
+
+    for (auto& dataKey : requiredData[plot]) {
+      if (--nConsumers[dataKey] == 0) releaseData(dataKey);
+    }
+    if (mMemoryBudget > 0) {
+      while (bufferSize > mMemoryBudget && !usageHistory.empty()) {
+        releaseData(usageHistory.back());
+      }
+    }
+  }
+  mKeepFileIndices = keepFileIndices;
+  if (!mKeepFileIndices && mIndexCacheDirectory.empty()) mFileIndexCache.clear();
+  return success;
+}
+
+//**************************************************************************************************
+/**
+ * Load data lazily and release them once all plots that need them were created.
+ * The memory budget (in MB) limits the size of the data buffer (0: unlimited).
+ */
+//**************************************************************************************************
+void PlotManager::SetUseStreamingMode(bool useStreamingMode, uint64_t memoryBudget)
+{
+  mUseStreamingMode = useStreamingMode;
+  mMemoryBudget = memoryBudget * 1024u * 1024u;
+}
+
+//**************************************************************************************************
+/**
+ * Estimates the memory needed for the content of data.
+ */
+//**************************************************************************************************
+uint64_t PlotManager::GetDataSize(const TObject* data)
+{
+  if (!data) return 0u;
+  if (data->InheritsFrom(TH1::Class())) {
+    auto hist = static_cast<const TH1*>(data);
+    return static_cast<uint64_t>(hist->GetNcells()) * ((hist->GetSumw2N() > 0) ? 2u : 1u) * sizeof(double_t);
+  } else if (data->InheritsFrom(THnBase::Class())) {
+    auto hist = static_cast<const THnBase*>(data);
+    return static_cast<uint64_t>(hist->GetNbins()) * (2u * sizeof(double_t) + hist->GetNdimensions() * sizeof(int32_t));
+  } else if (data->InheritsFrom(TGraph::Class())) {
+    return static_cast<uint64_t>(static_cast<const TGraph*>(data)->GetN()) * 4u * sizeof(double_t);
+  } else if (data->InheritsFrom(TGraph2D::Class())) {
+    return static_cast<uint64_t>(static_cast<const TGraph2D*>(data)->GetN()) * 6u * sizeof(double_t);
+  }
+  return 0u;
+}
+
+//**************************************************************************************************
+/**
+ * Determines which input data (inputID, dataName) are needed to create the plot.
+ */
+//**************************************************************************************************
+set<std::pair<string, string>> PlotManager::GetRequiredData(const Plot& plot) const
+{
+  set<std::pair<string, string>> requiredData;
+  for (auto& [padID, pad] : plot.GetPads()) {
+    for (auto& data : pad.GetData()) {
+      requiredData.insert({data->GetInputID(), data->GetName()});
+      if (data->GetType() == "ratio") {
+        const auto& ratio = std::dynamic_pointer_cast<Plot::Pad::Ratio>(data);
+        requiredData.insert({ratio->GetDenomIdentifier(), ratio->GetDenomName()});
+      }
+    }
+  }
+  return requiredData;
+}
+
+//**************************************************************************************************
+/**
+ * Process re-runs only plots whose definition or input files changed since they were last created.
+ * The book-keeping is stored in a manifest file within the output directory.
+ */
+//**************************************************************************************************
+void PlotManager::SetUseIncrementalMode(bool useIncrementalMode)
+{
+  mUseIncrementalMode = useIncrementalMode;
+}
+
+//**************************************************************************************************
+/**
+ * Hash of the full plot definition (after template resolution) and the input files it may be read from.
+ */
+//**************************************************************************************************
+size_t PlotManager::GetDefinitionHash(const Plot& plot) const
+{
+  std::ostringstream definition;
+  using boost::property_tree::write_xml;
+  // the template is serialized only once for all plots that are based on it
+  if (const Plot* plotTemplate = FindPlotTemplate(plot)) {
+    auto [it, isNew] = mPlotTemplateHashes.try_emplace(plotTemplate->GetName());
+    if (isNew) {
+      std::ostringstream templateDefinition;
+      write_xml(templateDefinition, plotTemplate->GetPropertyTree());
+      it->second = std::hash<string>{}(templateDefinition.str());
+    }
+    definition << it->second << ":";
+  }
+  write_xml(definition, plot.GetPropertyTree());
+  set<string> inputIDs;
+  for (auto& [inputID, dataName] : GetRequiredData(plot)) {
+    inputIDs.insert(inputID);
+  }
+  for (auto& inputID : inputIDs) {
+    definition << inputID << ":";
+    if (auto it = mInputFiles.find(inputID); it != mInputFiles.end()) {
+      for (auto& fileName : it->second) {
+        definition << fileName << ";";
+      }
+    }
+  }
+  return std::hash<string>{}(definition.str());
+}
+
+//**************************************************************************************************
+/**
+ * Split the creation of plots among independent runs (e.g. on different nodes of a batch cluster). Each run only reads
+ * the input data needed for its own plots. In "file" mode and in incremental mode the shards write separate output files
+ * and manifests to the output directory, which can be combined afterwards via MergeShards.
+ */
+//**************************************************************************************************
+void PlotManager::SetShard(uint32_t shardID, uint32_t nShards)
+{
+  if (nShards == 0 || shardID == 0 || shardID > nShards) {
+    ERROR("Invalid shard {}/{}. Creating all plots.", shardID, nShards);
+    shardID = nShards = 1u;
+  }
+  mShardID = shardID;
+  mNumShards = nShards;
+}
+
+//**************************************************************************************************
+/**
+ * Name of the output file of a shard (e.g. ResultPlots_shard2of4.root).
+ */
+//**************************************************************************************************
+string PlotManager::GetShardFileName(const string& fileName, uint32_t shardID, uint32_t nShards)
+{
+  std::filesystem::path filePath(fileName);
+  string shardFileName = fmt::format("{}_shard{}of{}{}", filePath.stem().string(), shardID, nShards, filePath.extension().string());
+  return (filePath.has_parent_path()) ? (filePath.parent_path() / shardFileName).string() : shardFileName;
+}
+
+//**************************************************************************************************
+/**
+ * Selects the plots of the current shard. The assignment only depends on the requested plots, such that all shards
+ * agree on it. The expected cost of a plot is estimated from the number of input data it needs to read, where data that
+ * are already read by a shard are for free. Plots are assigned greedily (most expensive first) to the shard with the
+ * lowest resulting cost, which keeps plots sharing their data together as long as the shards stay balanced.
+ * All pages of a pdf book are created by the same shard.
+ */
+//**************************************************************************************************
+vector<Plot*> PlotManager::GetShardPlots(const vector<Plot*>& plots, const string& outputMode) const
+{
+  // a gif as well as windows cannot be split among independent runs
+  if (outputMode == "interactive" || str_contains(outputMode, "gif")) {
+    if (mShardID != 1u) return {};
+    return plots;
+  }
+  using data_key_t = std::pair<string, string>; // inputID, dataName
+  struct shard_unit_t {
+    string name;
+    vector<size_t> plotIndices; // positions in plots
+    set<data_key_t> requiredData;
+  };
+  vector<shard_unit_t> units;
+  unordered_map<string, size_t> unitIndices; // name, position in units
+  for (size_t plotIndex = 0; plotIndex < plots.size(); ++plotIndex) {
+    const Plot& plot = *plots[plotIndex];
+    string unitName = (outputMode == "pdf-book") ? GetOutputFileName(plot, outputMode) : plot.GetUniqueName();
+    auto [unitIndex, isNew] = unitIndices.try_emplace(unitName, units.size());
+    if (isNew) units.push_back({unitName, {}, {}});
+    auto& unit = units[unitIndex->second];
+    unit.plotIndices.push_back(plotIndex);
+    auto requiredData = GetRequiredData(plot);
+    unit.requiredData.insert(requiredData.begin(), requiredData.end());
+  }
+  auto getCost = [](const shard_unit_t& unit) { return unit.plotIndices.size() + unit.requiredData.size(); };
+  vector<size_t> unitOrder(units.size());
+  std::iota(unitOrder.begin(), unitOrder.end(), 0u);
+  std::sort(unitOrder.begin(), unitOrder.end(), [&](size_t a, size_t b) {
+    return std::make_pair(getCost(units[b]), units[a].name) < std::make_pair(getCost(units[a]), units[b].name);
+  });
+
+  vector<uint64_t> shardCosts(mNumShards);
+  vector<set<data_key_t>> shardData(mNumShards);
+  vector<bool> isSelected(plots.size());
+  for (size_t unitIndex : unitOrder) {
+    auto& unit = units[unitIndex];
+    uint32_t bestShard{};
+    uint64_t bestCost{std::numeric_limits<uint64_t>::max()};
+    for (uint32_t shard = 0; shard < mNumShards; ++shard) {
+      uint64_t cost = shardCosts[shard] + unit.plotIndices.size();
+      for (auto& dataKey : unit.requiredData) {
+        if (shardData[shard].find(dataKey) == shardData[shard].end()) ++cost;
+      }
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestShard = shard;
+      }
+    }
+    shardCosts[bestShard] = bestCost;
+    shardData[bestShard].insert(unit.requiredData.begin(), unit.requiredData.end());
+    if (bestShard + 1 != mShardID) continue;
+    for (size_t plotIndex : unit.plotIndices) {
+      isSelected[plotIndex] = true;
+    }
+  }
+
+  // keep the order of the plots
+  vector<Plot*> shardPlots;
+  for (size_t plotIndex = 0; plotIndex < plots.size(); ++plotIndex) {
+    if (isSelected[plotIndex]) shardPlots.push_back(plots[plotIndex]);
+  }
+  return shardPlots;
+}
+
+//**************************************************************************************************
+/**
+ * Combines the results of all shards in the output directory: The canvases of the shard files ("file" mode) are copied to
+ * the output file with the same directory structure, and the manifests of the incremental mode are merged.
+ * The files of the shards are deleted afterwards.
+ */
+//**************************************************************************************************
+void PlotManager::MergeShards(uint32_t nShards)
+{
+  if (mNumShards > 1) {
+    ERROR("Shards have to be merged by a run that is not sharded itself.");
+    return;
+  }
+  std::function<void(TDirectory&, TDirectory&)> copyDirectory = [&](TDirectory& source, TDirectory& target) {
+    set<string> copiedNames;
+    for (auto obj : *source.GetListOfKeys()) {
+      TKey* key = static_cast<TKey*>(obj);
+      if (!copiedNames.insert(key->GetName()).second) continue; // older cycle
+      if (str_contains(key->GetClassName(), "TDirectory")) {
+        TDirectory* sourceDirectory = source.GetDirectory(key->GetName());
+        TDirectory* targetDirectory = target.GetDirectory(key->GetName());
+        if (!targetDirectory) targetDirectory = target.mkdir(key->GetName());
+        if (sourceDirectory && targetDirectory) copyDirectory(*sourceDirectory, *targetDirectory);
+        continue;
+      }
+      unique_ptr<TObject> object{key->ReadObj()};
+      if (!object || target.WriteTObject(object.get(), key->GetName(), "Overwrite") <= 0) {
+        ERROR("Cannot copy {} from file {}.", key->GetName(), source.GetName());
+        continue;
+      }
+      ++mNumPlotsInOutputFile;
+    }
+  };
+
+  set<string> mergedFiles;
+  for (uint32_t shardID = 1; shardID <= nShards; ++shardID) {
+    string shardFileName = mOutputDirectory + "/" + GetShardFileName(mOutputFileName, shardID, nShards);
+    if (!file_exists(shardFileName)) continue;
+    TFile shardFile(shardFileName.data(), "READ");
+    if (shardFile.IsZombie()) {
+      ERROR("Cannot open output file {} of shard {}.", shardFileName, shardID);
+      continue;
+    }
+    TFile* outputFile = GetOutputFile();
+    if (!outputFile) return;
+    copyDirectory(shardFile, *outputFile);
+    shardFile.Close();
+    mergedFiles.insert(shardFileName);
+  }
+  CloseOutputFile();
+
+  mManifest.clear();
+  ReadManifest(mOutputDirectory + "/" + gManifestFileName);
+  bool hasShardManifests = false;
+  for (uint32_t shardID = 1; shardID <= nShards; ++shardID) {
+    string shardManifestFileName = mOutputDirectory + "/" + GetShardFileName(gManifestFileName, shardID, nShards);
+    if (!file_exists(shardManifestFileName)) continue;
+    ReadManifest(shardManifestFileName);
+    mergedFiles.insert(shardManifestFileName);
+    hasShardManifests = true;
+  }
+  if (hasShardManifests) SaveManifest(mOutputDirectory + "/" + gManifestFileName);
+
+  for (auto& fileName : mergedFiles) {
+    std::error_code errorCode;
+    std::filesystem::remove(fileName, errorCode);
+  }
+  INFO("Merged {} file{} of {} shards.", mergedFiles.size(), (mergedFiles.size() == 1) ? "" : "s", nShards);
+}
+
+//**************************************************************************************************
+/**
+ * Reads the manifest of plots created in previous runs from the output directory.
+ */
+//**************************************************************************************************
+void PlotManager::LoadManifest()
+{
+  mManifest.clear();
+  if (mOutputDirectory.empty()) return;
+  // entries of the own shard are more recent than the merged ones
+  ReadManifest(mOutputDirectory + "/" + gManifestFileName);
+  if (mNumShards > 1) ReadManifest(GetManifestFileName());
+}
+
+//**************************************************************************************************
+/**
+ * Adds the entries of a manifest file. Existing entries for the same output files are replaced.
+ */
+//**************************************************************************************************
+void PlotManager::ReadManifest(const string& manifestFileName)
+{
+  if (!file_exists(manifestFileName)) return;
+  ptree manifestTree;
+  try {
+    using boost::property_tree::read_xml;
+    read_xml(manifestFileName, manifestTree);
+  } catch (...) {
+    WARNING("Cannot read manifest {}. All plots will be re-created.", manifestFileName);
+    return;
+  }
+  for (auto& [key, entry] : manifestTree) {
+    if (auto outputFile = entry.get_optional<string>("output")) {
+      mManifest[*outputFile] = entry;
+    }
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Writes the manifest of created plots to the output directory.
+ */
+//**************************************************************************************************
+void PlotManager::SaveManifest(const string& manifestFileName) const
+{
+  if (mOutputDirectory.empty() || !std::filesystem::is_directory(mOutputDirectory)) return;
+  ptree manifestTree;
+  for (auto& [outputFile, entry] : mManifest) {
+    manifestTree.add_child("PLOT", entry);
+  }
+  using boost::property_tree::xml_writer_settings;
+  xml_writer_settings<string> settings('\t', 1);
+  using boost::property_tree::write_xml;
+  write_xml(manifestFileName, manifestTree, std::locale(), settings);
+}
+
+//**************************************************************************************************
+/**
+ * Manifest of the current run. Each shard keeps its own manifest until they are merged.
+ */
+//**************************************************************************************************
+string PlotManager::GetManifestFileName() const
+{
+  return mOutputDirectory + "/" + ((mNumShards > 1) ? GetShardFileName(gManifestFileName, mShardID, mNumShards) : gManifestFileName);
+}
+
+//**************************************************************************************************
+/**
+ * Checks if output file exists and was created from the same definition and unchanged input files.
+ */
+//**************************************************************************************************
+bool PlotManager::IsUpToDate(const string& outputFile, size_t definitionHash) const
+{
+  auto entry = mManifest.find(outputFile);
+  if (entry == mManifest.end() || !std::filesystem::exists(outputFile)) return false;
+  if (entry->second.get<size_t>("hash", 0u) != definitionHash) return false;
+  if (auto inputs = entry->second.get_child_optional("inputs")) {
+    for (auto& [key, input] : *inputs) {
+      string fileName = input.get<string>("path", "");
+      std::error_code errorCode;
+      auto modificationTime = std::filesystem::last_write_time(fileName, errorCode);
+      if (errorCode) return false;
+      auto fileSize = std::filesystem::file_size(fileName, errorCode);
+      if (errorCode) return false;
+      if (input.get<int64_t>("mtime", 0) != modificationTime.time_since_epoch().count() || input.get<uintmax_t>("size", 0u) != fileSize) return false;
+    }
+  }
+  return true;
+}
+
+//**************************************************************************************************
+/**
+ * Stores definition hash and identity of all input files in manifest if the output file was (re-)created in this run.
+ */
+//**************************************************************************************************
+void PlotManager::UpdateManifest(const Plot& plot, const string& outputFile, size_t definitionHash, std::filesystem::file_time_type startTime)
+{
+  mManifest.erase(outputFile);
+  std::error_code errorCode;
+  auto outputTime = std::filesystem::last_write_time(outputFile, errorCode);
+  if (errorCode || outputTime < startTime) return;
+
+  set<string> inputFiles;
+  for (auto& [inputID, dataName] : GetRequiredData(plot)) {
+    if (auto input = mDataOrigin.find(inputID); input != mDataOrigin.end()) {
+      if (auto origin = input->second.find(dataName); origin != input->second.end()) {
+        inputFiles.insert(origin->second);
+        continue;
+      }
+    }
+    if (auto input = mDataBuffer.find(inputID); input != mDataBuffer.end()) {
+      auto data = input->second.find(dataName);
+      if (data != input->second.end() && !data->second) return; // data was not found and plot will therefore be re-created next time
+    }
+    // origin is unknown (e.g. data were read by another process), so the plot depends on all files of the input
+    auto input = mInputFiles.find(inputID);
+    if (input == mInputFiles.end() || input->second.empty()) {
+      WARNING("Cannot determine input files of plot {}. It will be re-created next time.", plot.GetUniqueName());
+      return;
+    }
+    for (auto& inputFile : input->second) {
+      inputFiles.insert(split_input_file_path(inputFile)[0]);
+    }
+  }
+
+  ptree entry;
+  entry.put("output", outputFile);
+  entry.put("hash", definitionHash);
+  ptree inputs;
+  for (auto& fileName : inputFiles) {
+    auto modificationTime = std::filesystem::last_write_time(fileName, errorCode);
+    if (errorCode) return;
+    auto fileSize = std::filesystem::file_size(fileName, errorCode);
+    if (errorCode) return;
+    ptree input;
+    input.put("path", fileName);
+    input.put("mtime", static_cast<int64_t>(modificationTime.time_since_epoch().count()));
+    input.put("size", fileSize);
+    inputs.add_child("FILE", input);
+  }
+  entry.put_child("inputs", inputs);
+  mManifest[outputFile] = entry;
+}
+
+//**************************************************************************************************
+/**
+ * Distributes the creation of plots over multiple worker processes.
+ * Each worker is a fork of the current process and therefore has its own ROOT state (gPad, gStyle, colors)
+ * and a copy-on-write view of the data buffer, which is filled before. Plots are assigned round-robin to the workers.
+ * In "file" mode the workers write their canvases to temporary files, which are copied to the output file in the end.
+ */
+//**************************************************************************************************
+void PlotManager::GeneratePlotsParallel(const vector<Plot*>& plots, const string& outputMode)
+{
+  uint32_t nWorkers = std::min(mNumWorkers, static_cast<uint32_t>(plots.size()));
+  bool isFileMode = (outputMode == "file");
+
+  pid_t managerPID = getpid();
+  auto getWorkerFileName = [&](uint32_t workerID) {
+    return (std::filesystem::temp_directory_path() / ("SciRooPlot_" + std::to_string(managerPID) + "_worker" + std::to_string(workerID) + ".root")).string();
+  };
+
+  // text extents measured by the workers are collected by the manager to store them on disk
+  auto getWorkerTextExtentFileName = [&](uint32_t workerID) {
+    return (std::filesystem::temp_directory_path() / ("SciRooPlot_" + std::to_string(managerPID) + "_worker" + std::to_string(workerID) + "_textExtents.txt")).string();
+  };
+
+  // events recorded by the workers are merged into the trace of the manager
+  auto getWorkerTraceFileName = [&](uint32_t workerID) {
+    return (std::filesystem::temp_directory_path() / ("SciRooPlot_" + std::to_string(managerPID) + "_worker" + std::to_string(workerID) + "_trace.txt")).string();
+  };
+
+  // in streaming mode the data are read by the workers, so the manager learns only from them where the data were found
+  auto getWorkerOriginFileName = [&](uint32_t workerID) {
+    return (std::filesystem::temp_directory_path() / ("SciRooPlot_" + std::to_string(managerPID) + "_worker" + std::to_string(workerID) + "_origins.txt")).string();
+  };
+
+  auto getWorkerPlots = [&](uint32_t workerID) {
+    vector<Plot*> workerPlots;
+    for (size_t plotIndex = workerID; plotIndex < plots.size(); plotIndex += nWorkers) {
+      workerPlots.push_back(plots[plotIndex]);
+    }
+    return workerPlots;
+  };
+
+  // data needed by multiple workers are read only once and shared; in streaming mode each worker reads its own data
+  if (!mUseStreamingMode) {
+    for (auto plot : plots) {
+      for (auto& [inputID, dataName] : GetRequiredData(*plot)) {
+        mDataBuffer[inputID][dataName];
+      }
+    }
+    if (!FillBuffer()) PrintBufferStatus(true);
+    FillProjectionCache(plots);
+  }
+
+  // buffered output would otherwise be duplicated in every worker
+  std::cout.flush();
+  std::fflush(nullptr);
+  bool isBatch = gROOT->IsBatch();
+  gROOT->SetBatch(true);
+
+  vector<pid_t> workers;
+  for (uint32_t workerID = 0; workerID < nWorkers; ++workerID) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      ERROR("Could not start worker process {}. Remaining plots will be created sequentially.", workerID);
+      break;
+    }
+    if (pid == 0) {
+      if (isFileMode) {
+        // the output file (possibly) opened by the manager must not be touched by the worker
+        static_cast<void>(mOutputFile.release());
+        {
+          TDirectory::TContext context; // keep the current directory (see GetOutputFile)
+          mOutputFile.reset(new TFile(getWorkerFileName(workerID).data(), "RECREATE"));
+        }
+        if (mOutputFile->IsZombie()) {
+          ERROR("Cannot create temporary file for worker {}.", workerID);
+          std::_Exit(EXIT_FAILURE);
+        }
+      }
+      int32_t exitCode = (GeneratePlots(getWorkerPlots(workerID), outputMode)) ? EXIT_SUCCESS : EXIT_FAILURE;
+      WaitForPendingOutputs();
+      if (isFileMode) {
+        mOutputFile->Close();
+        mOutputFile.reset();
+      }
+      if (!mTextExtentCacheFile.empty() && mTextExtentCache->isModified) mTextExtentCache->Save(getWorkerTextExtentFileName(workerID));
+      if (Profiler::IsEnabled()) Profiler::Instance().SaveEvents(getWorkerTraceFileName(workerID));
+      if (mUseStreamingMode) {
+        std::ofstream originFile(getWorkerOriginFileName(workerID));
+        for (auto& [inputID, origins] : mDataOrigin) {
+          for (auto& [dataName, fileName] : origins) {
+            originFile << inputID << "\t" << dataName << "\t" << fileName << "\n";
+          }
+        }
+      }
+      std::cout.flush();
+      std::fflush(nullptr);
+      // leave without running the destructors of this copy of the manager (which would e.g. save the plots again)
+      std::_Exit(exitCode);
+    }
+    workers.push_back(pid);
+  }
+
+  // plots of workers that could not be started are created by the manager itself
+  for (uint32_t workerID = workers.size(); workerID < nWorkers; ++workerID) {
+    GeneratePlots(getWorkerPlots(workerID), outputMode);
+  }
+
+  for (uint32_t workerID = 0; workerID < workers.size(); ++workerID) {
+    int32_t status{};
+    if (waitpid(workers[workerID], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+      WARNING("Worker {} did not finish successfully.", workerID);
+    }
+    if (!mTextExtentCacheFile.empty()) {
+      string workerTextExtentFileName = getWorkerTextExtentFileName(workerID);
+      if (mTextExtentCache->Load(workerTextExtentFileName)) mTextExtentCache->isModified = true;
+      std::error_code errorCode;
+      std::filesystem::remove(workerTextExtentFileName, errorCode);
+    }
+    if (Profiler::IsEnabled()) {
+      string workerTraceFileName = getWorkerTraceFileName(workerID);
+      Profiler::Instance().LoadEvents(workerTraceFileName);
+      std::error_code errorCode;
+      std::filesystem::remove(workerTraceFileName, errorCode);
+    }
+    if (mUseStreamingMode) {
+      string workerOriginFileName = getWorkerOriginFileName(workerID);
+      std::ifstream originFile(workerOriginFileName);
+      string line;
+      while (std::getline(originFile, line)) {
+        auto fields = split_string(line, '\t');
+        if (fields.size() != 3) continue;
+        mDataOrigin[fields[0]][fields[1]] = fields[2];
+        if (mInputFileTimes.find(fields[2]) == mInputFileTimes.end()) mInputFileTimes[fields[2]] = GetModificationTime(fields[2]);
+      }
+      originFile.close();
+      std::error_code errorCode;
+      std::filesystem::remove(workerOriginFileName, errorCode);
+    }
+  }
+  gROOT->SetBatch(isBatch);
+
+  if (!isFileMode) return;
+  for (uint32_t workerID = 0; workerID < workers.size(); ++workerID) {
+    string workerFileName = getWorkerFileName(workerID);
+    if (!std::filesystem::exists(workerFileName)) continue;
+    TFile workerFile(workerFileName.data(), "READ");
+    if (!workerFile.IsZombie()) {
+      // canvases are copied one by one in the order of the plots
+      for (size_t plotIndex = workerID; plotIndex < plots.size(); plotIndex += nWorkers) {
+        const string& uniqueName = plots[plotIndex]->GetUniqueName();
+        auto [subfolder, plotName] = GetOutputLocation(uniqueName);
+        unique_ptr<TCanvas> canvas{dynamic_cast<TCanvas*>(workerFile.Get((subfolder + "/" + plotName).data()))};
+        if (canvas) WriteToOutputFile(uniqueName, *canvas);
+      }
+      workerFile.Close();
+    }
+    gSystem->Unlink(workerFileName.data());
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Computes upfront the projections requested by the plots in case multiple projection threads are enabled.
+ * Projections of the same source modify its axis ranges and are therefore computed sequentially,
+ * while different sources are processed concurrently. Otherwise projections are computed when first needed.
+ */
+//**************************************************************************************************
+void PlotManager::FillProjectionCache(const vector<Plot*>& plots)
+{
+  if (mNumProjectionThreads <= 1) return;
+
+  map<TObject*, vector<Plot::Pad::Data::proj_info_t>> requestedProjections; // source, projections
+  auto addRequest = [&](const string& inputID, const string& dataName, const optional<Plot::Pad::Data::proj_info_t>& projInfo) {
+    if (!projInfo) return;
+    if (auto input = mDataBuffer.find(inputID); input != mDataBuffer.end()) {
+      if (auto data = input->second.find(dataName); data != input->second.end() && data->second) {
+        requestedProjections[data->second.get()].push_back(*projInfo);
+      }
+    }
+  };
+  for (auto plot : plots) {
+    for (auto& [padID, pad] : plot->GetPads()) {
+      for (auto& data : pad.GetData()) {
+        addRequest(data->GetInputID(), data->GetName(), data->GetProjInfo());
+        if (data->GetType() == "ratio") {
+          const auto& ratio = std::dynamic_pointer_cast<Plot::Pad::Ratio>(data);
+          addRequest(ratio->GetDenomIdentifier(), ratio->GetDenomName(), ratio->GetProjInfoDenom());
+        }
+      }
+    }
+  }
+  if (requestedProjections.empty()) return;
+
+  vector<std::pair<TObject*, vector<Plot::Pad::Data::proj_info_t>>> sources(requestedProjections.begin(), requestedProjections.end());
+  uint32_t nThreads = std::min(mNumProjectionThreads, static_cast<uint32_t>(sources.size()));
+  PlotPainter painter(false, mProjectionCache.get());
+  auto processSource = [&](size_t sourceIndex) {
+    for (auto& projInfo : sources[sourceIndex].second) {
+      painter.GetCachedProjection(sources[sourceIndex].first, projInfo);
+    }
+  };
+
+  bool addDirStatus = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(false);
+  if (nThreads > 1) {
+    ROOT::EnableThreadSafety();
+    std::atomic<size_t> nextSource{0u};
+    vector<std::thread> workers;
+    for (uint32_t i = 0; i < nThreads; ++i) {
+      workers.emplace_back([&]() {
+        for (size_t sourceIndex = nextSource++; sourceIndex < sources.size(); sourceIndex = nextSource++) {
+          processSource(sourceIndex);
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  } else {
+    processSource(0u);
+  }
+  TH1::AddDirectory(addDirStatus);
+}
+
+//**************************************************************************************************
+/**
+ * Input files opened while reading a group of inputs. Directories used as entry point of an input (file.root:sub/dir)
+ * are kept as well, since several inputs often refer to sub-directories of the same file.
+ * Each file is closed as soon as the last input file path of the group referring to it was read.
+ */
+//**************************************************************************************************
+struct PlotManager::input_file_pool_t {
+  map<string, unique_ptr<TFile>> files;         // physical file name, file (nullptr if it cannot be opened)
+  map<string, TObject*> directories;            // inputFilePath, entry point within the file
+  map<string, TFileOpenHandle*> pendingFiles;   // remote files that are opened in the background
+  map<string, uint32_t> nReferences;            // physical file name, number of input file paths still to be read
+  void OpenInBackground(const string& fileName)
+  {
+    if (files.find(fileName) != files.end() || pendingFiles.find(fileName) != pendingFiles.end()) return;
+    pendingFiles[fileName] = TFile::AsyncOpen(fileName.data());
+  }
+  void Release(const string& fileName)
+  {
+    if (auto references = nReferences.find(fileName); references != nReferences.end()) {
+      if (--references->second > 0) return;
+      nReferences.erase(references);
+    }
+    for (auto directory = directories.begin(); directory != directories.end();) {
+      if (split_input_file_path(directory->first)[0] == fileName) {
+        delete directory->second;
+        directory = directories.erase(directory);
+      } else {
+        ++directory;
+      }
+    }
+    if (auto pendingFile = pendingFiles.find(fileName); pendingFile != pendingFiles.end()) {
+      delete TFile::Open(pendingFile->second);
+      pendingFiles.erase(pendingFile);
+    }
+    files.erase(fileName);
+  }
+  ~input_file_pool_t()
+  {
+    // files that were not needed in the end (background opens are only started for files that are expected to contain data)
+    for (auto& [fileName, openHandle] : pendingFiles) {
+      delete TFile::Open(openHandle);
+    }
+    // directories have to be deleted before the files they belong to
+    for (auto& [inputFileName, directory] : directories) {
+      delete directory;
+    }
+    directories.clear();
+    files.clear();
+  }
+};
+
+//**************************************************************************************************
+/**
+ * Fills all the nodes defined in buffer hash map with data read from files.
+ */
+//**************************************************************************************************
+bool PlotManager::FillBuffer(const set<std::pair<string, string>>& skippedData)
+{
+  PROFILE_SCOPE("load", "FillBuffer");
+  vector<std::pair<string, vector<string>>> missingData; // inputID, dataNames
+  for (auto& [inputID, buffer] : mDataBuffer) {
+    vector<string> dataNames;
+    for (auto& [dataName, dataPtr] : buffer) {
+      if (!dataPtr && skippedData.find({inputID, dataName}) == skippedData.end()) dataNames.push_back(dataName);
+    }
+    if (!dataNames.empty()) missingData.push_back({inputID, std::move(dataNames)});
+  }
+
+  // inputs sharing a physical file are read in one go, such that the file is opened only once
+  vector<string> inputIDs;
+  for (auto& [inputID, dataNames] : missingData) {
+    inputIDs.push_back(inputID);
+  }
+  vector<vector<size_t>> readGroups = GetReadGroups(inputIDs);
+  vector<input_data_t> inputData(missingData.size());
+  auto readGroup = [&](const vector<size_t>& inputIndices) {
+    input_file_pool_t filePool;
+    // the first file of each input is needed in any case and remote ones are opened in the background right away,
+    // such that their latencies overlap (the following files are opened once it is clear that they are needed)
+    for (size_t inputIndex : inputIndices) {
+      auto inputFiles = mInputFiles.find(missingData[inputIndex].first);
+      if (inputFiles == mInputFiles.end()) continue;
+      bool isFirstFile = true;
+      for (auto& inputFileName : inputFiles->second) {
+        if (str_contains(inputFileName, ".csv", true) || str_contains(inputFileName, ".tsv", true) || !str_contains(inputFileName, ".root", true)) continue;
+        string fileName = split_input_file_path(inputFileName)[0];
+        ++filePool.nReferences[fileName];
+        if (isFirstFile && is_remote_file(fileName)) filePool.OpenInBackground(fileName);
+        isFirstFile = false;
+      }
+    }
+    for (size_t inputIndex : inputIndices) {
+      inputData[inputIndex] = ReadInputData(missingData[inputIndex].first, missingData[inputIndex].second, filePool);
+    }
+  };
+
+  // the groups are independent of each other and can therefore be read concurrently
+  uint32_t nThreads = std::min(mNumReaderThreads, static_cast<uint32_t>(readGroups.size()));
+  if (nThreads > 1) {
+    ROOT::EnableThreadSafety();
+    std::atomic<size_t> nextGroup{0u};
+    vector<std::thread> readers;
+    for (uint32_t i = 0; i < nThreads; ++i) {
+      readers.emplace_back([&]() {
+        for (size_t groupIndex = nextGroup++; groupIndex < readGroups.size(); groupIndex = nextGroup++) {
+          readGroup(readGroups[groupIndex]);
+        }
+      });
+    }
+    for (auto& reader : readers) {
+      reader.join();
+    }
+  } else {
+    for (auto& inputIndices : readGroups) {
+      readGroup(inputIndices);
+    }
+  }
+
+  // merge the data read for each input into the buffer
+  bool success = true;
+  for (size_t inputIndex = 0; inputIndex < missingData.size(); ++inputIndex) {
+    const string& inputID = missingData[inputIndex].first;
+    for (auto& [dataName, data] : inputData[inputIndex].data) {
+      mDataBuffer[inputID][dataName] = std::move(data);
+    }
+    for (auto& [dataName, fileName] : inputData[inputIndex].origin) {
+      mDataOrigin[inputID][dataName] = fileName;
+      if (mInputFileTimes.find(fileName) == mInputFileTimes.end()) mInputFileTimes[fileName] = GetModificationTime(fileName);
     }
+    success &= inputData[inputIndex].success;
   }
-  gSystem->Exec((string("mkdir -p ") + folderName).data());
-  canvas->SaveAs(fullName.data());
-  // reset TCandle range options to their default values after drawing data
-  TCandle::SetBoxRange(0.5);
-  TCandle::SetWhiskerRange(0.75);
-  return true;
+  PROFILE_COUNT("buffered data", std::accumulate(mDataBuffer.begin(), mDataBuffer.end(), int64_t{}, [](int64_t sum, auto& input) { return sum + static_cast<int64_t>(input.second.size()); }));
+  return success;
 }
 
 //**************************************************************************************************
 /**
- * Creates plots.
+ * Groups the inputs such that all inputs referring to the same physical file end up in the same group.
+ * Returns the positions of the inputs in each group (in ascending order).
  */
 //**************************************************************************************************
-void PlotManager::CreatePlots(const string& figureGroup, const string& figureCategory,
-                              vector<string> plotNames, const string& outputMode)
+vector<vector<size_t>> PlotManager::GetReadGroups(const vector<string>& inputIDs) const
 {
-  // first determine which data needs to be loaded
-  vector<Plot*> selectedPlots;
-  map<int32_t, set<int32_t>> requiredData;
-
-  for (auto& plot : mPlots) {
-    if (!figureGroup.empty() && !(plot.GetFigureGroup() == figureGroup)) {
-      continue;
-    } else if (!figureCategory.empty() && !(plot.GetFigureCategory() && *plot.GetFigureCategory() == figureCategory)) {
-      continue;
-    } else if (!plotNames.empty() && std::find(plotNames.begin(), plotNames.end(), plot.GetName()) == plotNames.end()) {
-      continue;
+  vector<vector<size_t>> readGroups;
+  map<string, size_t> fileGroups; // physical file name, read group
+  for (size_t inputIndex = 0; inputIndex < inputIDs.size(); ++inputIndex) {
+    set<string> fileNames;
+    if (auto inputFiles = mInputFiles.find(inputIDs[inputIndex]); inputFiles != mInputFiles.end()) {
+      for (auto& inputFileName : inputFiles->second) {
+        fileNames.insert(split_input_file_path(inputFileName)[0]);
+      }
     }
-
-    if (!plotNames.empty()) {
-      plotNames.erase(std::remove(plotNames.begin(), plotNames.end(), plot.GetName()), plotNames.end());
+    set<size_t> connectedGroups;
+    for (auto& fileName : fileNames) {
+      if (auto fileGroup = fileGroups.find(fileName); fileGroup != fileGroups.end()) connectedGroups.insert(fileGroup->second);
     }
-    selectedPlots.push_back(&plot);
-
-    // determine which input data are needed for plots
-    for (auto& [padID, pad] : plot.GetPads()) {
-      for (auto& data : pad.GetData()) {
-        mDataBuffer[data->GetInputID()][data->GetName()];
-        if (data->GetType() == "ratio") {
-          const auto& ratio = std::dynamic_pointer_cast<Plot::Pad::Ratio>(data);
-          mDataBuffer[ratio->GetDenomIdentifier()][ratio->GetDenomName()];
+    size_t groupIndex = readGroups.size();
+    if (connectedGroups.empty()) {
+      readGroups.emplace_back();
+    } else {
+      // this input connects groups that were separate so far
+      groupIndex = *connectedGroups.begin();
+      for (auto otherGroupIndex : connectedGroups) {
+        if (otherGroupIndex == groupIndex) continue;
+        auto& otherGroup = readGroups[otherGroupIndex];
+        readGroups[groupIndex].insert(readGroups[groupIndex].end(), otherGroup.begin(), otherGroup.end());
+        otherGroup.clear();
+        for (auto& [fileName, fileGroupIndex] : fileGroups) {
+          if (fileGroupIndex == otherGroupIndex) fileGroupIndex = groupIndex;
         }
       }
     }
-  }
-
-  // were definitions for all requested plots available?
-  if (!plotNames.empty()) {
-    for (auto& plotName : plotNames) {
-      WARNING("Could not find plot " GREEN_ "{}" _END " in group " YELLOW_ "{}" _END ".", plotName, figureGroup + ((!figureCategory.empty()) ? "/" + figureCategory : ""));
+    readGroups[groupIndex].push_back(inputIndex);
+    for (auto& fileName : fileNames) {
+      fileGroups[fileName] = groupIndex;
     }
   }
-
-  if (!FillBuffer()) PrintBufferStatus(true);
-  // generate plots
-  for (auto plot : selectedPlots) {
-    if (!GeneratePlot(*plot, outputMode))
-      ERROR("Plot " GREEN_ "{}" _END " from group " YELLOW_ "{}" _END " could not be created.", plot->GetName(), plot->GetFigureGroup() + ((plot->GetFigureCategory()) ? "/" + *plot->GetFigureCategory() : ""));
+  readGroups.erase(std::remove_if(readGroups.begin(), readGroups.end(), [](auto& readGroup) { return readGroup.empty(); }), readGroups.end());
+  for (auto& readGroup : readGroups) {
+    std::sort(readGroup.begin(), readGroup.end());
   }
+  return readGroups;
 }
 
 //**************************************************************************************************
 /**
- * Fills all the nodes defined in buffer hash map with data read from files.
+ * Reads the requested data of one input from the files belonging to it. The first file containing a data wins.
+ * This function does not modify the data buffer and can therefore be called concurrently for inputs that do not share a file pool.
  */
 //**************************************************************************************************
-bool PlotManager::FillBuffer()
+PlotManager::input_data_t PlotManager::ReadInputData(const string& inputID, const vector<string>& dataNames, input_file_pool_t& filePool)
 {
-  bool success = true;
-  for (auto& [inputID, buffer] : mDataBuffer) {
-    unordered_map<string, vector<string>> requiredData; // subdir, names
-    for (auto& [dataName, dataPtr] : buffer) {
-      if (dataPtr) continue;
-      auto pathPos = dataName.find_last_of("/");
-      string path;
-      string name = dataName;
-      if (pathPos != string::npos) {
-        path = name.substr(0, pathPos);
-        name.erase(0, pathPos + 1);
-      }
-      requiredData[std::move(path)].push_back(std::move(name));
-    }
-
-    // open all input files belonging to the current inputID and extract the data
-    for (auto& inputFileName : mInputFiles[inputID]) {
-      if (requiredData.empty()) break;
-      if (str_contains(inputFileName, ".csv", true)) {
-        string graphName = inputFileName.substr(inputFileName.rfind('/') + 1, inputFileName.rfind(".csv") - inputFileName.rfind('/') - 1);
-        ReadDataCSV(inputFileName, graphName, inputID);
-        vector<string>& names = requiredData[""];
-        names.erase(std::remove_if(names.begin(), names.end(), [&](auto& name) { return name == graphName; }), names.end());
-        if (names.empty()) requiredData.erase("");
-      }
-      if (!str_contains(inputFileName, ".root", true)) continue;
-      // check if only a sub-folder in input file should be searched
-      auto fileNamePath = split_string(inputFileName, ':');
-      string& fileName = fileNamePath[0];
+  PROFILE_SCOPE_DETAIL("load", "ReadInputData", inputID);
+  input_data_t result;
+  unordered_map<string, vector<string>> requiredData; // subdir, names
+  for (auto& dataName : dataNames) {
+    auto pathPos = dataName.find_last_of("/");
+    string path;
+    string name = dataName;
+    if (pathPos != string::npos) {
+      path = name.substr(0, pathPos);
+      name.erase(0, pathPos + 1);
+    }
+    requiredData[std::move(path)].push_back(std::move(name));
+  }
 
-      if (!std::filesystem::exists(fileName)) {
-        WARNING("Input file {} not found.", fileName);
-        continue;
+  // open all input files belonging to the current inputID and extract the data
+  auto inputFiles = mInputFiles.find(inputID);
+  if (inputFiles == mInputFiles.end()) {
+    result.success = false;
+    return result;
+  }
+  // the next file of the input is opened in the background if the current one does not contain all of the required data
+  auto openNextFile = [&](const string& currentInputFileName) {
+    auto inputFileName = std::find(inputFiles->second.begin(), inputFiles->second.end(), currentInputFileName);
+    while (inputFileName != inputFiles->second.end() && ++inputFileName != inputFiles->second.end()) {
+      if (str_contains(*inputFileName, ".csv", true) || str_contains(*inputFileName, ".tsv", true) || !str_contains(*inputFileName, ".root", true)) continue;
+      string fileName = split_input_file_path(*inputFileName)[0];
+      if (is_remote_file(fileName)) filePool.OpenInBackground(fileName);
+      return;
+    }
+  };
+  auto containsAll = [&](auto isFound) {
+    return std::all_of(requiredData.begin(), requiredData.end(), [&](auto& pathAndNames) {
+      return std::all_of(pathAndNames.second.begin(), pathAndNames.second.end(), [&](const string& name) { return isFound(pathAndNames.first, name); });
+    });
+  };
+
+  for (auto& inputFileName : inputFiles->second) {
+    if (str_contains(inputFileName, ".csv", true) || str_contains(inputFileName, ".tsv", true)) {
+      if (!requiredData.empty()) ReadDataCSV(inputFileName, inputID, requiredData, result);
+      continue;
+    }
+    if (!str_contains(inputFileName, ".root", true)) continue;
+    // check if only a sub-folder in input file should be searched
+    auto fileNamePath = split_input_file_path(inputFileName);
+    string& fileName = fileNamePath[0];
+    // the file is closed once none of the remaining input file paths of the group refers to it anymore
+    struct file_reference_t {
+      input_file_pool_t& filePool;
+      const string& fileName;
+      ~file_reference_t() { filePool.Release(fileName); }
+    } fileReference{filePool, fileName};
+    if (requiredData.empty()) continue;
+    bool isRemoteFile = is_remote_file(fileName);
+
+    if (!isRemoteFile && !std::filesystem::exists(fileName)) {
+      WARNING("Input file {} not found.", fileName);
+      continue;
+    }
+    // with a valid cached index the file only needs to be opened if it contains any of the required data
+    shared_ptr<const file_index_t> fileIndex = GetFileIndex(inputFileName);
+    if (fileIndex && std::none_of(requiredData.begin(), requiredData.end(), [&](auto& pathAndNames) {
+          return std::any_of(pathAndNames.second.begin(), pathAndNames.second.end(), [&](const string& name) { return FindInFileIndex(*fileIndex, pathAndNames.first, name); });
+        })) {
+      openNextFile(inputFileName);
+      continue;
+    }
+    if (fileIndex && !containsAll([&](const string& path, const string& name) { return FindInFileIndex(*fileIndex, path, name) != nullptr; })) openNextFile(inputFileName);
+
+    auto [openedFile, isNewFile] = filePool.files.try_emplace(fileName);
+    if (isNewFile) {
+      PROFILE_SCOPE_DETAIL("load", "OpenFile", fileName);
+      if (auto pendingFile = filePool.pendingFiles.find(fileName); pendingFile != filePool.pendingFiles.end()) {
+        openedFile->second.reset(TFile::Open(pendingFile->second));
+        filePool.pendingFiles.erase(pendingFile);
+      } else {
+        openedFile->second.reset(TFile::Open(fileName.data(), "READ"));
       }
-      TFile inputFile(fileName.data(), "READ");
-      if (inputFile.IsZombie()) {
+      if (!openedFile->second || openedFile->second->IsZombie()) {
         WARNING("Cannot open input file {}.", fileName);
-        continue;
+        openedFile->second.reset();
       }
+    }
+    TFile* inputFile = openedFile->second.get();
+    if (!inputFile) {
+      openNextFile(inputFileName);
+      continue;
+    }
 
-      TObject* folder = &inputFile;
+    TObject* folder = inputFile;
 
-      // find top level entry point for this input file
-      if (fileNamePath.size() > 1) {
+    // find top level entry point for this input file
+    bool isSharedFolder = true;
+    if (fileNamePath.size() > 1) {
+      if (auto directory = filePool.directories.find(inputFileName); directory != filePool.directories.end()) {
+        folder = directory->second;
+      } else {
         auto filePath = split_string(fileNamePath[1], '/');
         // append sub-specification from input name
         folder = FindSubDirectory(folder, filePath);
         if (!folder) {
           ERROR("Subdirectory {} not found in file {}.", fileNamePath[1], fileName);
-          return false;
+          result.success = false;
+          return result;
         }
+        // objects are read from directories without modifying them, whereas lists hand over the objects taken from them
+        isSharedFolder = folder->InheritsFrom(TDirectory::Class());
+        if (isSharedFolder) filePool.directories[inputFileName] = folder;
       }
+    }
 
-      vector<string> emptySubDirs;
+    string suffix = gNameGroupSeparator + inputID;
+    auto extractRequiredData = [&](auto readData) {
       for (auto& [pathStr, names] : requiredData) {
-        auto path = split_string(pathStr, '/');
-        TObject* subfolder = FindSubDirectory(folder, path);
-        if (subfolder) {
-          // recursively traverse the file and look for input files
-          string prefix = (pathStr.empty()) ? "" : pathStr + "/";
-          string suffix = gNameGroupSeparator + inputID;
-          ReadData(subfolder, names, prefix, suffix, inputID);
-          // in case a subdirectory was opened, properly delete it
-          if (!path.empty() && subfolder != &inputFile) {
-            delete subfolder;
-            subfolder = nullptr;
-          }
-        }
-        if (names.empty()) emptySubDirs.push_back(pathStr);
+        string prefix = (pathStr.empty()) ? "" : pathStr + "/";
+        names.erase(std::remove_if(names.begin(), names.end(),
+                                   [&](const string& name) {
+                                     TObject* obj{nullptr};
+                                     {
+                                       PROFILE_SCOPE_DETAIL("load", "ReadObj", prefix + name);
+                                       obj = readData(pathStr, name);
+                                     }
+                                     if (!obj) return false;
+                                     string fullName = prefix + name;
+                                     static_cast<TNamed*>(obj)->SetName((fullName + suffix).data());
+                                     result.data[fullName].reset(obj);
+                                     result.origin[fullName] = fileName;
+                                     return true;
+                                   }),
+                    names.end());
       }
-      // finally also remove top level folder
-      if (folder != &inputFile) {
-        delete folder;
-        folder = nullptr;
+    };
+
+    // sub-directories are registered in their mother directory, so they have to be deleted in reverse order
+    vector<unique_ptr<TObject>> indexedFolders;
+    auto deleteIndexedFolders = [&]() {
+      while (!indexedFolders.empty()) {
+        indexedFolders.pop_back();
       }
+    };
 
-      for (auto& pathStr : emptySubDirs) {
-        requiredData.erase(pathStr);
+    bool isIndexStale = false;
+    if (fileIndex) {
+      // jump directly to the location of the objects stored in the cached index
+      map<string, TObject*> openedFolders;
+      map<string, TObject*> readObjects; // location within the file, object
+      extractRequiredData([&](const string& pathStr, const string& name) -> TObject* {
+        auto entryPath = FindInFileIndex(*fileIndex, pathStr, name);
+        if (!entryPath) return nullptr;
+        string location = (entryPath->empty()) ? name : *entryPath + "/" + name;
+        if (auto readObject = readObjects.find(location); readObject != readObjects.end()) {
+          // the same object was requested before via a different path (and may have been taken out of its list already)
+          TObject* obj = readObject->second->Clone();
+          if (obj && obj->InheritsFrom(TH1::Class())) static_cast<TH1*>(obj)->SetDirectory(0);
+          return obj;
+        }
+        TObject* obj = ReadFromFileIndex(folder, *entryPath, name, openedFolders, indexedFolders);
+        if (obj) {
+          readObjects[location] = obj;
+        } else {
+          isIndexStale = true;
+        }
+        return obj;
+      });
+      deleteIndexedFolders();
+    }
+    if (!fileIndex || isIndexStale) {
+      // index all objects in the file once and read only the ones that are actually needed
+      key_index_t keyIndex;
+      {
+        PROFILE_SCOPE_DETAIL("load", "BuildKeyIndex", fileName);
+        // only indices that are kept need to cover the whole file
+        bool isIndexKept = (!mIndexCacheDirectory.empty() || mKeepFileIndices);
+        if (BuildKeyIndex(folder, "", keyIndex, indexedFolders, (isIndexKept) ? nullptr : &requiredData)) StoreFileIndex(inputFileName, keyIndex);
       }
+      bool isComplete = containsAll([&](const string& path, const string& name) {
+        auto entries = keyIndex.find(name);
+        return entries != keyIndex.end() && std::any_of(entries->second.begin(), entries->second.end(), [&](auto& entry) { return is_in_folder(entry.path, path); });
+      });
+      if (!isComplete) openNextFile(inputFileName);
+      // for remote files each read would be a separate round trip
+      unique_ptr<TFileCacheRead> readCache;
+      if (isRemoteFile) readCache = PrefetchKeys(*inputFile, keyIndex, requiredData);
+      extractRequiredData([&](const string& pathStr, const string& name) { return ReadFromKeyIndex(keyIndex, pathStr, name); });
+      if (readCache) inputFile->SetCacheRead(nullptr);
+      deleteIndexedFolders();
+    }
+
+    vector<string> emptySubDirs;
+    for (auto& [pathStr, names] : requiredData) {
+      if (names.empty()) emptySubDirs.push_back(pathStr);
+    }
+    // finally also remove top level folder (unless it is kept for the other inputs of the group)
+    if (!isSharedFolder) {
+      delete folder;
+      folder = nullptr;
+    }
+
+    for (auto& pathStr : emptySubDirs) {
+      requiredData.erase(pathStr);
     }
-    success &= requiredData.empty();
   }
-  return success;
+  result.success = requiredData.empty();
+  return result;
 }
 
 //**************************************************************************************************
@@ -718,105 +2604,472 @@ void PlotManager::PrintLoadedPlots() const
 
 //**************************************************************************************************
 /**
- * Recursively reads data from folder / list and adds it to output data array. Found dataNames are removed from the vectors.
+ * Recursively builds an index of all objects in folder / list. Objects that reside directly in a directory are not read.
+ * The entries for each name are ordered by precedence: objects on the current level come before those in deeper levels.
+ * If required data are specified, only sub-folders that may still contain the first match of any of them are read and indexed.
+ * Returns false if sub-folders were left out.
  */
 //**************************************************************************************************
-void PlotManager::ReadData(TObject* folder, vector<string>& dataNames, const string& prefix, const string& suffix, const string& inputID)
+bool PlotManager::BuildKeyIndex(TObject* folder, const string& path, key_index_t& keyIndex, vector<unique_ptr<TObject>>& indexedFolders, const unordered_map<string, vector<string>>* requiredData) const
 {
-  TCollection* itemList = nullptr;
+  vector<std::pair<string, TObject*>> subFolders; // name, folder (nullptr if it still needs to be read)
+  vector<TKey*> subFolderKeys;
+
   if (folder->InheritsFrom(TDirectory::Class())) {
-    itemList = static_cast<TDirectoryFile*>(folder)->GetListOfKeys();
-  } else if (folder->InheritsFrom(TFolder::Class())) {
-    itemList = static_cast<TFolder*>(folder)->GetListOfFolders();
-  } else if (folder->InheritsFrom(TCollection::Class())) {
-    itemList = static_cast<TCollection*>(folder);
+    for (auto obj : *static_cast<TDirectory*>(folder)->GetListOfKeys()) {
+      TKey* key = static_cast<TKey*>(obj);
+      string className = key->GetClassName();
+      bool isTraversable = str_contains(className, "TDirectory") || str_contains(className, "TFolder") || str_contains(className, "TList") || str_contains(className, "THashList") || str_contains(className, "TObjArray");
+      if (isTraversable) {
+        subFolders.push_back({key->GetName(), nullptr});
+        subFolderKeys.push_back(key);
+      } else {
+        keyIndex[key->GetName()].push_back({path, className, key, nullptr, nullptr});
+      }
+    }
   } else {
-    ERROR("Data-format {} not supported.", folder->ClassName());
-    return;
+    TCollection* itemList = nullptr;
+    if (folder->InheritsFrom(TFolder::Class())) {
+      itemList = static_cast<TFolder*>(folder)->GetListOfFolders();
+    } else if (folder->InheritsFrom(TCollection::Class())) {
+      itemList = static_cast<TCollection*>(folder);
+    } else {
+      ERROR("Data-format {} not supported.", folder->ClassName());
+      return true;
+    }
+    itemList->SetOwner();
+    for (auto obj : *itemList) {
+      if (obj->InheritsFrom(TDirectory::Class()) || obj->InheritsFrom(TFolder::Class()) || obj->InheritsFrom(TCollection::Class())) {
+        subFolders.push_back({obj->GetName(), obj});
+        subFolderKeys.push_back(nullptr);
+      } else {
+        keyIndex[obj->GetName()].push_back({path, obj->ClassName(), nullptr, obj, itemList});
+      }
+    }
   }
-  itemList->SetOwner();
 
-  // first match should always be the one in current level; traverse deeper only if not found
-  for (bool traverse : {false, true}) {
+  // a sub-folder is needed if it can contain data that are not found so far (matches found before take precedence)
+  auto isNeeded = [&](const string& subFolderPath) {
+    if (!requiredData) return true;
+    for (auto& [requiredPath, names] : *requiredData) {
+      if (!is_in_folder(subFolderPath, requiredPath) && !is_in_folder(requiredPath, subFolderPath)) continue;
+      for (auto& name : names) {
+        auto entries = keyIndex.find(name);
+        if (entries == keyIndex.end() || std::none_of(entries->second.begin(), entries->second.end(), [&](auto& entry) { return is_in_folder(entry.path, requiredPath); })) return true;
+      }
+    }
+    return false;
+  };
+
+  bool isComplete = true;
+  for (size_t subFolderIndex = 0; subFolderIndex < subFolders.size(); ++subFolderIndex) {
+    auto& [name, subFolder] = subFolders[subFolderIndex];
+    string subFolderPath = (path.empty()) ? name : path + "/" + name;
+    if (!isNeeded(subFolderPath)) {
+      isComplete = false;
+      continue;
+    }
+    // only directories and lists need to be read in order to look inside
+    if (TKey* key = subFolderKeys[subFolderIndex]) {
+      subFolder = key->ReadObj();
+      if (!subFolder) continue;
+      if (subFolder->InheritsFrom(TCollection::Class())) static_cast<TCollection*>(subFolder)->SetOwner();
+      indexedFolders.emplace_back(subFolder);
+    }
+    isComplete &= BuildKeyIndex(subFolder, subFolderPath, keyIndex, indexedFolders, requiredData);
+  }
+  return isComplete;
+}
 
-    TIter iterator = itemList->begin();
-    TObject* obj{};
-    bool deleteObject;
-    bool removeFromList;
+//**************************************************************************************************
+/**
+ * Reads object with given name that is located in path (or any of its sub-folders) via the key index.
+ * Returns nullptr if no such object exists. Ownership of the object is passed to the caller.
+ */
+//**************************************************************************************************
+TObject* PlotManager::ReadFromKeyIndex(key_index_t& keyIndex, const string& path, const string& name) const
+{
+  auto entries = keyIndex.find(name);
+  if (entries == keyIndex.end()) return nullptr;
+  for (auto& entry : entries->second) {
+    if (!is_in_folder(entry.path, path)) continue;
+    TObject* obj{nullptr};
+    if (entry.key) {
+      obj = entry.key->ReadObj();
+    } else if (entry.collection) {
+      // take object out of the list, which would otherwise delete it
+      entry.collection->Remove(entry.object);
+      entry.collection = nullptr;
+      obj = entry.object;
+    } else {
+      // the same object was requested before via a different path
+      obj = entry.object->Clone();
+    }
+    if (obj && obj->InheritsFrom(TH1::Class())) static_cast<TH1*>(obj)->SetDirectory(0); // demand ownership for histogram
+    return obj;
+  }
+  return nullptr;
+}
 
-    while (iterator != itemList->end()) {
-      obj = *iterator;
-      deleteObject = true;
-      removeFromList = true;
+//**************************************************************************************************
+/**
+ * Location of input file and plot definition indices that are kept between runs (empty path disables the cache).
+ */
+//**************************************************************************************************
+void PlotManager::SetIndexCacheDirectory(const string& path)
+{
+  mIndexCacheDirectory = expand_path(path);
+}
 
-      string curDataName; // name of current key or data
-      // read actual object to memory when traversing a directory
-      if (obj->IsA() == TKey::Class()) {
-        string className = static_cast<TKey*>(obj)->GetClassName();
-        curDataName = obj->GetName();
+//**************************************************************************************************
+/**
+ * File in which the sizes of text measured for laying out legends and text boxes are kept between runs.
+ */
+//**************************************************************************************************
+void PlotManager::SetTextExtentCacheFile(const string& fileName)
+{
+  mTextExtentCacheFile = (fileName.empty()) ? fileName : expand_path(fileName);
+  if (!mTextExtentCacheFile.empty()) mTextExtentCache->Load(mTextExtentCacheFile);
+}
 
-        bool isTraversable = str_contains(className, "TDirectory") || str_contains(className, "TFolder") || str_contains(className, "TList") || str_contains(className, "THashList") || str_contains(className, "TObjArray");
-        if ((traverse && isTraversable) || std::find(dataNames.begin(), dataNames.end(), curDataName) != dataNames.end()) {
-          obj = static_cast<TKey*>(obj)->ReadObj();
-          removeFromList = false;
-        } else {
-          ++iterator;
-          continue;
-        }
-      }
+//**************************************************************************************************
+/**
+ * Returns cached index of input file if it is still up to date, otherwise nullptr.
+ */
+//**************************************************************************************************
+shared_ptr<const PlotManager::file_index_t> PlotManager::GetFileIndex(const string& inputFileName)
+{
+  if (mIndexCacheDirectory.empty() && !mKeepFileIndices) return nullptr;
+  string fileName = split_input_file_path(inputFileName)[0];
+  std::error_code errorCode;
+  auto modificationTime = std::filesystem::last_write_time(fileName, errorCode).time_since_epoch().count();
+  if (errorCode) return nullptr;
+  auto fileSize = std::filesystem::file_size(fileName, errorCode);
+  if (errorCode) return nullptr;
+
+  std::lock_guard<std::mutex> lock(mFileIndexMutex);
+  auto fileIndex = mFileIndexCache.find(inputFileName);
+  if (fileIndex == mFileIndexCache.end()) {
+    if (mIndexCacheDirectory.empty()) return nullptr;
+    std::ifstream indexFile(GetFileIndexName(inputFileName));
+    string line;
+    if (!indexFile || !std::getline(indexFile, line) || line != gFileIndexHeader) return nullptr;
+    if (!std::getline(indexFile, line) || line != inputFileName) return nullptr;
+    auto newIndex = std::make_shared<file_index_t>();
+    if (!(indexFile >> newIndex->modificationTime >> newIndex->fileSize)) return nullptr;
+    std::getline(indexFile, line);
+    while (std::getline(indexFile, line)) {
+      auto delimiterPos = line.find('\t');
+      if (delimiterPos == string::npos) continue;
+      newIndex->entries[line.substr(0, delimiterPos)].push_back(line.substr(delimiterPos + 1));
+    }
+    fileIndex = mFileIndexCache.insert({inputFileName, std::move(newIndex)}).first;
+  }
+  if (fileIndex->second->modificationTime != static_cast<int64_t>(modificationTime) || fileIndex->second->fileSize != fileSize) {
+    mFileIndexCache.erase(fileIndex);
+    return nullptr;
+  }
+  return fileIndex->second;
+}
 
-      // in case this object is directory or list, repeat the same for this substructure
-      if (obj->InheritsFrom(TDirectory::Class()) || obj->InheritsFrom(TFolder::Class()) || obj->InheritsFrom(TCollection::Class())) {
-        if (traverse) {
-          ReadData(obj, dataNames, prefix, suffix, inputID);
-        } else if (removeFromList) {
-          removeFromList = false;
-          deleteObject = false;
-        }
-      } else {
-        // the key name supersedes the actual data name (in case they are different when written to file via h->Write("myKeyName"))
-        if (curDataName.empty()) curDataName = obj->GetName();
-        if (auto it = std::find(dataNames.begin(), dataNames.end(), curDataName); it != dataNames.end()) {
-          if (obj->InheritsFrom(TH1::Class())) static_cast<TH1*>(obj)->SetDirectory(0); // demand ownership for histogram
-          itemList->Remove(obj);
-          dataNames.erase(it);
-          string fullName = prefix + curDataName;
-          static_cast<TNamed*>(obj)->SetName((fullName + suffix).data());
-          mDataBuffer[inputID][fullName].reset(obj);
-          removeFromList = false;
-          deleteObject = false;
-        }
-      }
+//**************************************************************************************************
+/**
+ * Registers the byte ranges of the keys needed from a file in a read cache, such that they are fetched with one vectored read
+ * as soon as the first of them is read. Returns nullptr if none of the data can be read via keys.
+ */
+//**************************************************************************************************
+unique_ptr<TFileCacheRead> PlotManager::PrefetchKeys(TFile& file, const key_index_t& keyIndex, const unordered_map<string, vector<string>>& requiredData) const
+{
+  constexpr int64_t maxCacheSize{256 * 1024 * 1024};
+  vector<TKey*> keys;
+  int64_t cacheSize{};
+  for (auto& [path, names] : requiredData) {
+    for (auto& name : names) {
+      auto entries = keyIndex.find(name);
+      if (entries == keyIndex.end()) continue;
+      // same precedence as in ReadFromKeyIndex
+      auto entry = std::find_if(entries->second.begin(), entries->second.end(), [&](auto& entry) { return is_in_folder(entry.path, path); });
+      if (entry == entries->second.end() || !entry->key) continue;
+      keys.push_back(entry->key);
+      cacheSize += entry->key->GetNbytes();
+    }
+  }
+  if (keys.empty()) return nullptr;
+  // keys that do not fit in the cache anymore are read individually
+  auto readCache = std::make_unique<TFileCacheRead>(&file, static_cast<Int_t>(std::min(cacheSize, maxCacheSize)));
+  file.SetCacheRead(readCache.get());
+  for (auto key : keys) {
+    readCache->Prefetch(key->GetSeekKey(), key->GetNbytes());
+  }
+  return readCache;
+}
+
+//**************************************************************************************************
+/**
+ * Converts the key index of an input file to its persistent form and saves it in the cache directory (if set).
+ */
+//**************************************************************************************************
+void PlotManager::StoreFileIndex(const string& inputFileName, const key_index_t& keyIndex)
+{
+  if (mIndexCacheDirectory.empty() && !mKeepFileIndices) return;
+  string fileName = split_input_file_path(inputFileName)[0];
+  std::error_code errorCode;
+  auto fileIndex = std::make_shared<file_index_t>();
+  fileIndex->modificationTime = std::filesystem::last_write_time(fileName, errorCode).time_since_epoch().count();
+  if (errorCode) return;
+  fileIndex->fileSize = std::filesystem::file_size(fileName, errorCode);
+  if (errorCode) return;
+  for (auto& [name, entries] : keyIndex) {
+    auto& paths = fileIndex->entries[name];
+    for (auto& entry : entries) {
+      paths.push_back(entry.path);
+    }
+  }
 
-      // increase iterator before removing objects from collection
-      ++iterator;
-      if (removeFromList) {
-        if (!itemList->Remove(obj)) {
-          ERROR("Could not remove item {} ({}) from collection {}.", obj->GetName(), static_cast<void*>(obj), itemList->GetName());
+  if (!mIndexCacheDirectory.empty()) {
+    std::filesystem::create_directories(mIndexCacheDirectory, errorCode);
+    if (errorCode) {
+      WARNING("Cannot create index cache directory {}.", mIndexCacheDirectory);
+      return;
+    }
+    // write to temporary file first so concurrent runs never see incomplete indices
+    string indexFileName = GetFileIndexName(inputFileName);
+    string tmpFileName = indexFileName + "." + std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+      std::ofstream indexFile(tmpFileName);
+      indexFile << gFileIndexHeader << "\n"
+                << inputFileName << "\n"
+                << fileIndex->modificationTime << " " << fileIndex->fileSize << "\n";
+      for (auto& [name, paths] : fileIndex->entries) {
+        for (auto& path : paths) {
+          indexFile << name << "\t" << path << "\n";
         }
       }
-      if (deleteObject) {
-        delete obj;
+    }
+    std::filesystem::rename(tmpFileName, indexFileName, errorCode);
+    if (errorCode) std::filesystem::remove(tmpFileName, errorCode);
+  }
+  std::lock_guard<std::mutex> lock(mFileIndexMutex);
+  mFileIndexCache[inputFileName] = std::move(fileIndex);
+}
+
+//**************************************************************************************************
+/**
+ * Name of the cache file for the index of input file.
+ */
+//**************************************************************************************************
+string PlotManager::GetFileIndexName(const string& inputFileName) const
+{
+  return mIndexCacheDirectory + "/" + std::to_string(std::hash<string>{}(inputFileName)) + ".idx";
+}
+
+//**************************************************************************************************
+/**
+ * Looks up location of object with given name in path (or any of its sub-folders) in file index.
+ */
+//**************************************************************************************************
+const string* PlotManager::FindInFileIndex(const file_index_t& fileIndex, const string& path, const string& name) const
+{
+  auto entries = fileIndex.entries.find(name);
+  if (entries == fileIndex.entries.end()) return nullptr;
+  for (auto& entryPath : entries->second) {
+    if (is_in_folder(entryPath, path)) return &entryPath;
+  }
+  return nullptr;
+}
+
+//**************************************************************************************************
+/**
+ * Reads object at known location within the file. Folders and lists opened on the way are kept for subsequent requests.
+ * Ownership of the object is passed to the caller.
+ */
+//**************************************************************************************************
+TObject* PlotManager::ReadFromFileIndex(TObject* folder, const string& path, const string& name, map<string, TObject*>& openedFolders, vector<unique_ptr<TObject>>& ownedFolders) const
+{
+  TObject* location = OpenIndexedFolder(folder, path, openedFolders, ownedFolders);
+  if (!location) return nullptr;
+  TObject* obj{nullptr};
+  if (location->InheritsFrom(TDirectory::Class())) {
+    if (TKey* key = static_cast<TDirectory*>(location)->FindKey(name.data())) obj = key->ReadObj();
+  } else {
+    TCollection* itemList = (location->InheritsFrom(TFolder::Class())) ? static_cast<TFolder*>(location)->GetListOfFolders() : static_cast<TCollection*>(location);
+    obj = itemList->FindObject(name.data());
+    if (obj) itemList->Remove(obj);
+  }
+  if (obj && obj->InheritsFrom(TH1::Class())) static_cast<TH1*>(obj)->SetDirectory(0); // demand ownership for histogram
+  return obj;
+}
+
+//**************************************************************************************************
+/**
+ * Opens folder or list at path (relative to entry point folder) step by step.
+ */
+//**************************************************************************************************
+TObject* PlotManager::OpenIndexedFolder(TObject* folder, const string& path, map<string, TObject*>& openedFolders, vector<unique_ptr<TObject>>& ownedFolders) const
+{
+  if (path.empty()) return folder;
+  if (auto it = openedFolders.find(path); it != openedFolders.end()) return it->second;
+
+  auto delimiterPos = path.find_last_of('/');
+  string parentPath = (delimiterPos == string::npos) ? "" : path.substr(0, delimiterPos);
+  string name = (delimiterPos == string::npos) ? path : path.substr(delimiterPos + 1);
+  TObject* parent = OpenIndexedFolder(folder, parentPath, openedFolders, ownedFolders);
+
+  TObject* subFolder{nullptr};
+  if (parent && parent->InheritsFrom(TDirectory::Class())) {
+    if (TKey* key = static_cast<TDirectory*>(parent)->FindKey(name.data())) {
+      subFolder = key->ReadObj();
+      if (subFolder) {
+        if (subFolder->InheritsFrom(TCollection::Class())) static_cast<TCollection*>(subFolder)->SetOwner();
+        ownedFolders.emplace_back(subFolder);
       }
-      if (dataNames.empty()) return;
     }
+  } else if (parent && parent->InheritsFrom(TFolder::Class())) {
+    subFolder = static_cast<TFolder*>(parent)->GetListOfFolders()->FindObject(name.data());
+  } else if (parent && parent->InheritsFrom(TCollection::Class())) {
+    subFolder = static_cast<TCollection*>(parent)->FindObject(name.data());
   }
+  openedFolders[path] = subFolder;
+  return subFolder;
 }
 
 //**************************************************************************************************
 /**
- * Read data from csv file.
+ * Read the requested graphs from csv file. All graphs of the file are extracted in a single pass over the (memory mapped) file.
+ * The names found in this file are removed from the required data.
  */
 //**************************************************************************************************
-void PlotManager::ReadDataCSV(const string& inputFileName, const string& graphName, const string& inputIdentifier)
+void PlotManager::ReadDataCSV(const string& inputFileName, const string& inputIdentifier, unordered_map<string, vector<string>>& requiredData, input_data_t& result) const
 {
-  // extract from path the csv file name that will then become graph name TODO: protect this against wrong usage...
-  string delimiter = "\t"; // TODO: this must somehow be user definable
-  string pattern = "%lg %lg %lg %lg";
-  TGraphErrors* graph = new TGraphErrors(inputFileName.data(), pattern.data(), delimiter.data());
-  string uniqueName = graphName + gNameGroupSeparator + inputIdentifier;
-  graph->SetName(uniqueName.data());
-  mDataBuffer[inputIdentifier][graphName].reset(graph);
+  string fileName = std::filesystem::path(inputFileName).stem().string();
+  csv_format_t format;
+  if (auto it = mCSVFormats.find(inputIdentifier); it != mCSVFormats.end()) format = it->second;
+
+  // find out which of the graphs provided by this file are needed
+  auto takeRequest = [&](const string& path, const string& name) {
+    auto names = requiredData.find(path);
+    if (names == requiredData.end()) return false;
+    auto it = std::find(names->second.begin(), names->second.end(), name);
+    if (it == names->second.end()) return false;
+    names->second.erase(it);
+    if (names->second.empty()) requiredData.erase(names);
+    return true;
+  };
+  vector<std::pair<string, csv_graph_t>> graphs; // dataName, layout
+  if (format.graphs.empty()) {
+    if (takeRequest("", fileName)) graphs.push_back({fileName, {fileName, 0u, 1u, 2u, 3u}});
+  } else {
+    for (auto& graph : format.graphs) {
+      if (takeRequest(fileName, graph.name)) graphs.push_back({fileName + "/" + graph.name, graph});
+    }
+  }
+  if (graphs.empty()) return;
+
+  int32_t fileDescriptor = open(inputFileName.data(), O_RDONLY);
+  struct stat fileStatus {};
+  if (fileDescriptor < 0 || fstat(fileDescriptor, &fileStatus) != 0) {
+    if (fileDescriptor >= 0) close(fileDescriptor);
+    WARNING("Cannot open input file {}.", inputFileName);
+    result.success = false;
+    return;
+  }
+  size_t fileSize = fileStatus.st_size;
+  void* mappedFile = (fileSize > 0) ? mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0) : nullptr;
+  close(fileDescriptor);
+  if (mappedFile == MAP_FAILED) {
+    WARNING("Cannot read input file {}.", inputFileName);
+    result.success = false;
+    return;
+  }
+  if (mappedFile) madvise(mappedFile, fileSize, MADV_SEQUENTIAL);
+
+  auto parseNumber = [](const char* first, const char* last, double_t& value) {
+    while (first < last && (*first == ' ' || *first == '\t')) ++first;
+    if (first < last && *first == '+') ++first;
+    if (first == last) return false;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto [end, errorCode] = std::from_chars(first, last, value);
+    if (errorCode != std::errc()) return false;
+#else
+    string field(first, last);
+    char* fieldEnd{nullptr};
+    value = std::strtod(field.data(), &fieldEnd);
+    const char* end = first + (fieldEnd - field.data());
+    if (end == first) return false;
+#endif
+    while (end < last && (*end == ' ' || *end == '\t')) ++end;
+    return end == last;
+  };
+
+  uint8_t nColumns{};
+  for (auto& [dataName, graph] : graphs) {
+    for (auto& column : {optional<uint8_t>(graph.x), optional<uint8_t>(graph.y), graph.ex, graph.ey}) {
+      if (column) nColumns = std::max<uint8_t>(nColumns, *column + 1);
+    }
+  }
+  struct columns_t {
+    vector<double_t> x, y, ex, ey;
+  };
+  vector<columns_t> columns(graphs.size());
+  vector<double_t> row(nColumns);
+  vector<uint8_t> isValid(nColumns);
+
+  // runs of blanks count as one delimiter for whitespace separated files
+  bool isWhitespaceDelimited = (format.delimiter == ' ' || format.delimiter == '\t');
+  auto isDelimiter = [&](char c) { return (isWhitespaceDelimited) ? (c == ' ' || c == '\t') : (c == format.delimiter); };
+
+  const char* fileBegin = static_cast<const char*>(mappedFile);
+  const char* fileEnd = fileBegin + fileSize;
+  uint64_t lineNumber{};
+  uint64_t nSkippedLines{};
+  for (const char* line = fileBegin; line < fileEnd;) {
+    const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', fileEnd - line));
+    if (!lineEnd) lineEnd = fileEnd;
+    const char* nextLine = lineEnd + 1;
+    if (lineEnd > line && *(lineEnd - 1) == '\r') --lineEnd;
+    if (lineNumber++ < format.skipLines || line == lineEnd || *line == format.comment) {
+      line = nextLine;
+      continue;
+    }
+
+    std::fill(isValid.begin(), isValid.end(), 0u);
+    const char* field = line;
+    for (uint8_t column = 0; column < nColumns; ++column) {
+      if (isWhitespaceDelimited) {
+        while (field < lineEnd && isDelimiter(*field)) ++field;
+      }
+      const char* fieldEnd = field;
+      while (fieldEnd < lineEnd && !isDelimiter(*fieldEnd)) ++fieldEnd;
+      isValid[column] = parseNumber(field, fieldEnd, row[column]);
+      if (fieldEnd == lineEnd) break;
+      field = fieldEnd + 1;
+    }
+
+    bool isSkipped = false;
+    for (size_t i = 0; i < graphs.size(); ++i) {
+      const csv_graph_t& graph = graphs[i].second;
+      if (!isValid[graph.x] || !isValid[graph.y]) {
+        isSkipped = true;
+        continue;
+      }
+      columns[i].x.push_back(row[graph.x]);
+      columns[i].y.push_back(row[graph.y]);
+      columns[i].ex.push_back((graph.ex && isValid[*graph.ex]) ? row[*graph.ex] : 0.);
+      columns[i].ey.push_back((graph.ey && isValid[*graph.ey]) ? row[*graph.ey] : 0.);
+    }
+    nSkippedLines += isSkipped;
+    line = nextLine;
+  }
+  if (mappedFile) munmap(mappedFile, fileSize);
+  if (nSkippedLines) WARNING("Ignored {} line{} of {} that could not be parsed.", nSkippedLines, (nSkippedLines == 1) ? "" : "s", inputFileName);
+
+  for (size_t i = 0; i < graphs.size(); ++i) {
+    auto& [dataName, graph] = graphs[i];
+    TGraphErrors* graphPtr = new TGraphErrors(columns[i].x.size(), columns[i].x.data(), columns[i].y.data(), columns[i].ex.data(), columns[i].ey.data());
+    graphPtr->SetName((dataName + gNameGroupSeparator + inputIdentifier).data());
+    result.data[dataName].reset(graphPtr);
+    result.origin[dataName] = inputFileName;
+  }
 }
 
 //**************************************************************************************************
@@ -876,50 +3129,53 @@ void PlotManager::ExtractPlotsFromFile(const string& plotFileName,
   uint32_t nFoundPlots{};
   bool isSearchRequest = (mode == "find");
 
-  std::regex groupRegex{group};
-  std::regex categoryRegex{category};
-  std::regex plotNameRegex{plotName};
-
-  ptree& inputTree = ReadPlotTemplatesFromFile(plotFileName);
-  for (auto& plotGroupTree : inputTree) {
+  // plain names are compared literally and ".*" matches everything, only the remaining patterns need regex matching
+  auto getMatcher = [](const string& pattern) -> std::function<bool(const string&)> {
+    if (pattern == ".*") return [](const string&) { return true; };
+    if (!is_regex(pattern)) return [pattern](const string& value) { return value == pattern; };
+    return [patternRegex = std::regex{pattern}](const string& value) { return std::regex_match(value, patternRegex); };
+  };
+  auto matchesGroup = getMatcher(group);
+  auto matchesCategory = getMatcher(category);
+  auto matchesPlotName = getMatcher(plotName);
+
+  const plot_file_index_t* plotFileIndex = GetPlotFileIndex(plotFileName);
+  if (!plotFileIndex) return;
+  std::ifstream plotFile(expand_path(plotFileName), std::ios::binary);
+  vector<Plot> foundPlots;
+  for (auto& entry : plotFileIndex->entries) {
     // first filter by group
-    string groupIdentifier = plotGroupTree.first.substr(string("GROUP::").size());
-    bool isTemplate = (groupIdentifier == "PLOT_TEMPLATES");
-
-    if (!isTemplate && !std::regex_match(groupIdentifier, groupRegex)) {
+    bool isTemplate = (entry.group == "PLOT_TEMPLATES");
+    if (!isTemplate && !matchesGroup(entry.group)) {
       continue;
     }
 
-    for (auto& plotTree : plotGroupTree.second) {
-      if (isTemplate) {
-        Plot plot(plotTree.second);
+    if (isTemplate) {
+      try {
+        Plot plot(ReadPlotDefinition(plotFile, entry));
         AddPlotTemplate(plot);
-        continue;
+      } catch (...) {
+        ERROR("Could not generate plot template {} from XML file.", entry.name);
       }
+      continue;
+    }
 
-      const string& plotName = plotTree.second.get<string>("name");
-      const string& figureGroup = plotTree.second.get<string>("figure_group");
-      optional<string> figureCategoryOpt;
-      read_from_tree(plotTree.second, figureCategoryOpt, "figure_category");
-      string figureCategory = (figureCategoryOpt) ? *figureCategoryOpt : "";
-
-      if (!std::regex_match(figureCategory, categoryRegex) || !std::regex_match(plotName, plotNameRegex)) {
-        continue;
-      }
+    if (!matchesCategory(entry.category) || !matchesPlotName(entry.name)) {
+      continue;
+    }
 
-      ++nFoundPlots;
-      if (isSearchRequest) {
-        INFO(" - " GREEN_ "{}" _END " in group " YELLOW_ "{}" _END, plotName, figureGroup + ((!figureCategory.empty()) ? "/" + figureCategory : ""));
-      } else {
-        try {
-          Plot plot(plotTree.second);
-          AddPlot(plot);
-        } catch (...) {
-          ERROR("Could not generate plot {} from XML file.", plotTree.first);
-        }
+    ++nFoundPlots;
+    if (isSearchRequest) {
+      INFO(" - " GREEN_ "{}" _END " in group " YELLOW_ "{}" _END, entry.name, entry.group + ((!entry.category.empty()) ? "/" + entry.category : ""));
+    } else {
+      try {
+        foundPlots.emplace_back(ReadPlotDefinition(plotFile, entry));
+      } catch (...) {
+        ERROR("Could not generate plot {} from XML file.", entry.name);
       }
     }
   }
+  AddPlots(std::move(foundPlots));
   if (nFoundPlots == 0) {
     ERROR("Found no plots matching the request " GREEN_ "{}" _END " in " YELLOW_ "{}/{}" _END ".", plotName, group, category);
   } else {
@@ -931,6 +3187,136 @@ void PlotManager::ExtractPlotsFromFile(const string& plotFileName,
   }
 }
 
+//**************************************************************************************************
+/**
+ * Creates the plots matching the request (see ExtractPlotsFromFile) and keeps them up to date until the program is stopped.
+ * Whenever the plot definition file or one of the input files is rewritten, only the data from the modified input files are read
+ * again and only plots that depend on them or whose definition changed are re-created.
+ * The dependencies of the plots are determined from the data they require and the files these data were read from.
+ * Plots that were added to the manager before are removed.
+ */
+//**************************************************************************************************
+void PlotManager::WatchPlots(const string& plotFileName,
+                             const string& mode,
+                             const string& plotName,
+                             const string& group,
+                             const string& category)
+{
+  if (mode == "interactive" || mode == "find" || mode == "load" || str_contains(mode, "gif")) {
+    ERROR("Watch mode is not available for mode {}.", mode);
+    return;
+  }
+  string expandedPlotFileName = expand_path(plotFileName);
+
+  auto loadPlots = [&]() {
+    ClearPlots();
+    ExtractPlotsFromFile(plotFileName, "load", plotName, group, category);
+    map<string, size_t> definitionHashes; // unique name, hash of its definition
+    for (auto& plot : mPlots) {
+      definitionHashes[plot.GetUniqueName()] = GetDefinitionHash(plot);
+    }
+    return definitionHashes;
+  };
+  auto getDependentPlots = [&]() {
+    map<string, set<string>> dependentPlots; // physical input file, unique names of the plots using its data
+    for (auto& plot : mPlots) {
+      for (auto& [inputID, dataName] : GetRequiredData(plot)) {
+        if (auto input = mDataOrigin.find(inputID); input != mDataOrigin.end()) {
+          if (auto origin = input->second.find(dataName); origin != input->second.end()) {
+            dependentPlots[origin->second].insert(plot.GetUniqueName());
+            continue;
+          }
+        }
+        // data that were not found (yet) could appear in any file of the input
+        if (auto inputFiles = mInputFiles.find(inputID); inputFiles != mInputFiles.end()) {
+          for (auto& inputFile : inputFiles->second) {
+            dependentPlots[split_input_file_path(inputFile)[0]].insert(plot.GetUniqueName());
+          }
+        }
+      }
+    }
+    return dependentPlots;
+  };
+
+  map<string, int64_t> fileTimes; // watched file, modification time
+  fileTimes[expandedPlotFileName] = GetModificationTime(expandedPlotFileName);
+  for (auto& [inputID, inputFiles] : mInputFiles) {
+    for (auto& inputFile : inputFiles) {
+      string fileName = split_input_file_path(inputFile)[0];
+      fileTimes[fileName] = GetModificationTime(fileName);
+    }
+  }
+
+  // files are usually re-created rather than modified in place, so the directories containing them are watched
+  int32_t watcher{-1};
+#ifdef __linux__
+  watcher = inotify_init1(IN_CLOEXEC);
+  set<string> watchedDirectories;
+  for (auto& [fileName, modificationTime] : fileTimes) {
+    string directory = std::filesystem::path(fileName).parent_path().string();
+    if (directory.empty()) directory = ".";
+    if (watcher >= 0 && watchedDirectories.insert(directory).second) {
+      inotify_add_watch(watcher, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    }
+  }
+#endif
+  auto waitForChanges = [&]() {
+    if (watcher < 0) {
+      gSystem->Sleep(1000);
+      return;
+    }
+    char events[4096];
+    pollfd watcherFD{watcher, POLLIN, 0};
+    poll(&watcherFD, 1, -1);
+    // wait until the writing of the files has settled
+    do {
+      if (read(watcher, events, sizeof(events)) < 0) break;
+    } while (poll(&watcherFD, 1, 500) > 0);
+  };
+
+  auto definitionHashes = loadPlots();
+  CreatePlots("", "", {}, mode);
+  auto dependentPlots = getDependentPlots();
+  INFO("Watching {} file{} for changes.", fileTimes.size(), (fileTimes.size() == 1) ? "" : "s");
+
+  while (true) {
+    waitForChanges();
+    vector<string> modifiedFiles;
+    for (auto& [fileName, modificationTime] : fileTimes) {
+      int64_t curModificationTime = GetModificationTime(fileName);
+      if (curModificationTime == modificationTime) continue;
+      modificationTime = curModificationTime;
+      modifiedFiles.push_back(fileName);
+    }
+    if (modifiedFiles.empty()) continue;
+
+    set<string> affectedPlots;
+    for (auto& fileName : modifiedFiles) {
+      INFO("File {} was modified.", fileName);
+      if (fileName == expandedPlotFileName) {
+        auto newDefinitionHashes = loadPlots();
+        for (auto& [uniqueName, definitionHash] : newDefinitionHashes) {
+          auto oldDefinitionHash = definitionHashes.find(uniqueName);
+          if (oldDefinitionHash == definitionHashes.end() || oldDefinitionHash->second != definitionHash) affectedPlots.insert(uniqueName);
+        }
+        definitionHashes = std::move(newDefinitionHashes);
+      } else if (auto plots = dependentPlots.find(fileName); plots != dependentPlots.end()) {
+        affectedPlots.insert(plots->second.begin(), plots->second.end());
+      }
+    }
+    ClearOutdatedData();
+
+    vector<Plot*> selectedPlots;
+    for (auto& plot : mPlots) {
+      if (affectedPlots.find(plot.GetUniqueName()) != affectedPlots.end()) selectedPlots.push_back(&plot);
+    }
+    INFO("Re-creating {} plot{} affected by the changes.", selectedPlots.size(), (selectedPlots.size() == 1) ? "" : "s");
+    if (selectedPlots.empty()) continue;
+    CreateSelectedPlots(std::move(selectedPlots), mode);
+    dependentPlots = getDependentPlots();
+  }
+}
+
 //****************************************************************************************
 /**
  * Defines a set of standard plot templates with quadratic axis frame and consistent layout among them.
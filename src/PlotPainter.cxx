@@ -21,10 +21,18 @@
 #include "SciRooPlot.h"
 #include "Logging.h"
 #include "Helpers.h"
+#include "Profiling.h"
 
 // std dependencies
 #include <regex>
 #include <numeric>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <array>
+#include <unistd.h>
 
 // root dependencies
 #include "TROOT.h"
@@ -128,6 +136,19 @@ constexpr bool is_2d()
   return is_hist_2d<T>() || is_graph_2d<T>() || is_func_2d<T>();
 }
 
+//**************************************************************************************************
+/**
+ * Hands back the data borrowed from the buffer in the state they were found in.
+ * Must only happen after the canvas referencing them was saved and destroyed.
+ */
+//**************************************************************************************************
+PlotPainter::~PlotPainter()
+{
+  for (auto restore = mRestoreBorrowedData.rbegin(); restore != mRestoreBorrowedData.rend(); ++restore) {
+    (*restore)();
+  }
+}
+
 //**************************************************************************************************
 /**
  * Function to generate the plot.
@@ -135,13 +156,29 @@ constexpr bool is_2d()
 //**************************************************************************************************
 unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<string, unordered_map<string, unique_ptr<TObject>>>& dataBuffer)
 {
+  PROFILE_SCOPE("paint", "GeneratePlot");
   bool fail = false;
+  mDrawnData.clear();
+  mPrivateBoxes.clear();
+  mUndecimatedStatistics.clear();
 
   double_t canvasWidth = plot.GetWidth().value_or(gStyle->GetCanvasDefW());
   double_t canvasHeight = plot.GetHeight().value_or(gStyle->GetCanvasDefH());
-  // generate canvas with 'invisible' dummy size to avoid annoying popup window
-  unique_ptr<TCanvas> canvas_ptr{new TCanvas(plot.GetUniqueName().data(), plot.GetUniqueName().data(), 1., 1.)};
-  if (gROOT->IsBatch()) {
+
+  // in batch mode the canvas and pads of an earlier plot with identical layout are re-used in case they are available
+  mLayout = (mLayoutPool && gROOT->IsBatch()) ? GetLayout(plot) : "";
+  unique_ptr<TCanvas> canvas_ptr = (mLayout.empty()) ? nullptr : mLayoutPool->Acquire(mLayout);
+  bool isRecycled = (canvas_ptr != nullptr);
+  if (isRecycled) {
+    canvas_ptr->SetName(plot.GetUniqueName().data());
+    canvas_ptr->SetTitle(plot.GetUniqueName().data());
+  } else {
+    // generate canvas with 'invisible' dummy size to avoid annoying popup window
+    canvas_ptr.reset(new TCanvas(plot.GetUniqueName().data(), plot.GetUniqueName().data(), 1., 1.));
+  }
+  if (isRecycled) {
+    // size and settings of the canvas are part of the layout
+  } else if (gROOT->IsBatch()) {
     canvas_ptr->SetCanvasSize(canvasWidth, canvasHeight);
   } else {
     auto canvasImp = static_cast<TRootCanvas*>(canvas_ptr->GetCanvasImp());
@@ -155,14 +192,16 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
     canvasImp->FitCanvas();
   }
 
-  canvas_ptr->SetMargin(0., 0., 0., 0.);
+  if (!isRecycled) {
+    canvas_ptr->SetMargin(0., 0., 0., 0.);
 
-  // apply user settings for plot
-  if (plot.GetFillColor()) canvas_ptr->SetFillColor(*plot.GetFillColor());
-  if (plot.GetFillStyle()) canvas_ptr->SetFillStyle(*plot.GetFillStyle());
-  if (plot.GetFillOpacity()) canvas_ptr->SetFillColor(TColor::GetColorTransparent(canvas_ptr->GetFillColor(), *plot.GetFillOpacity()));
+    // apply user settings for plot
+    if (plot.GetFillColor()) canvas_ptr->SetFillColor(*plot.GetFillColor());
+    if (plot.GetFillStyle()) canvas_ptr->SetFillStyle(*plot.GetFillStyle());
+    if (plot.GetFillOpacity()) canvas_ptr->SetFillColor(GetTransparentColor(canvas_ptr->GetFillColor(), *plot.GetFillOpacity()));
 
-  if (plot.IsFixAspectRatio()) canvas_ptr->SetFixedAspectRatio(*plot.IsFixAspectRatio());
+    if (plot.IsFixAspectRatio()) canvas_ptr->SetFixedAspectRatio(*plot.IsFixAspectRatio());
+  }
 
   auto& padDefaults = plot[0];
   for (const auto& [padID, dummy] : plot.GetPads()) {
@@ -185,21 +224,34 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
     canvas_ptr->cd();
     string padName = "Pad_" + std::to_string(padID);
 
-    TPad* pad_ptr = new TPad(padName.data(), "", padPos[0], padPos[1], padPos[2], padPos[3]);
-
-    if (auto& marginTop = get_first(pad.GetMarginTop(), padDefaults.GetMarginTop())) pad_ptr->SetTopMargin(*marginTop);
-    if (auto& marginBottom = get_first(pad.GetMarginBottom(), padDefaults.GetMarginBottom())) pad_ptr->SetBottomMargin(*marginBottom);
-    if (auto& marginLeft = get_first(pad.GetMarginLeft(), padDefaults.GetMarginLeft())) pad_ptr->SetLeftMargin(*marginLeft);
-    if (auto& marginRight = get_first(pad.GetMarginRight(), padDefaults.GetMarginRight())) pad_ptr->SetRightMargin(*marginRight);
-    if (auto& padFillColor = get_first(pad.GetFillColor(), padDefaults.GetFillColor())) pad_ptr->SetFillColor(*padFillColor);
-    if (auto& padFillStyle = get_first(pad.GetFillStyle(), padDefaults.GetFillStyle())) pad_ptr->SetFillStyle(*padFillStyle);
-    if (auto& padFillOpacity = get_first(pad.GetFillOpacity(), padDefaults.GetFillOpacity())) pad_ptr->SetFillColor(TColor::GetColorTransparent(pad_ptr->GetFillColor(), *padFillOpacity));
-    if (auto& frameFillColor = get_first(pad.GetFrameFillColor(), padDefaults.GetFrameFillColor())) pad_ptr->SetFrameFillColor(*frameFillColor);
-    if (auto& frameFillStyle = get_first(pad.GetFrameFillStyle(), padDefaults.GetFrameFillStyle())) pad_ptr->SetFrameFillStyle(*frameFillStyle);
-    if (auto& frameFillOpacity = get_first(pad.GetFrameFillOpacity(), padDefaults.GetFrameFillOpacity())) pad_ptr->SetFrameFillColor(TColor::GetColorTransparent(pad_ptr->GetFrameFillColor(), *frameFillOpacity));
-    if (auto& frameBorderColor = get_first(pad.GetFrameBorderColor(), padDefaults.GetFrameBorderColor())) pad_ptr->SetFrameLineColor(*frameBorderColor);
-    if (auto& frameBorderStyle = get_first(pad.GetFrameBorderStyle(), padDefaults.GetFrameBorderStyle())) pad_ptr->SetFrameLineStyle(*frameBorderStyle);
-    if (auto& frameBorderWidth = get_first(pad.GetFrameBorderWidth(), padDefaults.GetFrameBorderWidth())) pad_ptr->SetFrameLineWidth(*frameBorderWidth);
+    TPad* pad_ptr{nullptr};
+    if (isRecycled) {
+      pad_ptr = static_cast<TPad*>(canvas_ptr->GetPad(padID));
+      // the axis settings of the previous plot are not part of the layout
+      pad_ptr->SetLogx(gStyle->GetOptLogx());
+      pad_ptr->SetLogy(gStyle->GetOptLogy());
+      pad_ptr->SetLogz(gStyle->GetOptLogz());
+      pad_ptr->SetTickx(gStyle->GetPadTickX());
+      pad_ptr->SetTicky(gStyle->GetPadTickY());
+      pad_ptr->SetGridx(gStyle->GetPadGridX());
+      pad_ptr->SetGridy(gStyle->GetPadGridY());
+    } else {
+      pad_ptr = new TPad(padName.data(), "", padPos[0], padPos[1], padPos[2], padPos[3]);
+
+      if (auto& marginTop = get_first(pad.GetMarginTop(), padDefaults.GetMarginTop())) pad_ptr->SetTopMargin(*marginTop);
+      if (auto& marginBottom = get_first(pad.GetMarginBottom(), padDefaults.GetMarginBottom())) pad_ptr->SetBottomMargin(*marginBottom);
+      if (auto& marginLeft = get_first(pad.GetMarginLeft(), padDefaults.GetMarginLeft())) pad_ptr->SetLeftMargin(*marginLeft);
+      if (auto& marginRight = get_first(pad.GetMarginRight(), padDefaults.GetMarginRight())) pad_ptr->SetRightMargin(*marginRight);
+      if (auto& padFillColor = get_first(pad.GetFillColor(), padDefaults.GetFillColor())) pad_ptr->SetFillColor(*padFillColor);
+      if (auto& padFillStyle = get_first(pad.GetFillStyle(), padDefaults.GetFillStyle())) pad_ptr->SetFillStyle(*padFillStyle);
+      if (auto& padFillOpacity = get_first(pad.GetFillOpacity(), padDefaults.GetFillOpacity())) pad_ptr->SetFillColor(GetTransparentColor(pad_ptr->GetFillColor(), *padFillOpacity));
+      if (auto& frameFillColor = get_first(pad.GetFrameFillColor(), padDefaults.GetFrameFillColor())) pad_ptr->SetFrameFillColor(*frameFillColor);
+      if (auto& frameFillStyle = get_first(pad.GetFrameFillStyle(), padDefaults.GetFrameFillStyle())) pad_ptr->SetFrameFillStyle(*frameFillStyle);
+      if (auto& frameFillOpacity = get_first(pad.GetFrameFillOpacity(), padDefaults.GetFrameFillOpacity())) pad_ptr->SetFrameFillColor(GetTransparentColor(pad_ptr->GetFrameFillColor(), *frameFillOpacity));
+      if (auto& frameBorderColor = get_first(pad.GetFrameBorderColor(), padDefaults.GetFrameBorderColor())) pad_ptr->SetFrameLineColor(*frameBorderColor);
+      if (auto& frameBorderStyle = get_first(pad.GetFrameBorderStyle(), padDefaults.GetFrameBorderStyle())) pad_ptr->SetFrameLineStyle(*frameBorderStyle);
+      if (auto& frameBorderWidth = get_first(pad.GetFrameBorderWidth(), padDefaults.GetFrameBorderWidth())) pad_ptr->SetFrameLineWidth(*frameBorderWidth);
+    }
     if (auto& candleBoxRange = get_first(pad.GetDefaultCandleBoxRange(), padDefaults.GetDefaultCandleBoxRange())) TCandle::SetBoxRange(*candleBoxRange);
     if (auto& candleWhiskerRange = get_first(pad.GetDefaultCandleWhiskerRange(), padDefaults.GetDefaultCandleWhiskerRange())) TCandle::SetWhiskerRange(*candleWhiskerRange);
 
@@ -233,8 +285,10 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
     // TODO: color gradient feature can be used for 2d palette as well
     if (auto& palette = get_first(pad.GetPalette(), padDefaults.GetPalette())) gStyle->SetPalette(*palette);
 
-    pad_ptr->SetNumber(padID);
-    pad_ptr->Draw();
+    if (!isRecycled) {
+      pad_ptr->SetNumber(padID);
+      pad_ptr->Draw();
+    }
     pad_ptr->cd();
 
     if (pad.GetData().empty()) {
@@ -261,11 +315,13 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
     uint16_t dataIndex{};
     for (auto& data : pad.GetData()) {
       if (data->GetDrawingOptions()) drawingOptions += *data->GetDrawingOptions();
+      bool isBorrowed{false};
       // obtain a copy of the current data
       // retrieve the actual pointer to the data
       auto processData = [&, padID = padID](auto&& data_ptr) {
         using data_type = std::decay_t<decltype(data_ptr)>;
 
+        if (isBorrowed) BorrowData(data_ptr);
         data_ptr->SetTitle(""); // FIXME: only make this invisible but don't remove useful metadata
 
         optional<drawing_options_t> defaultDrawingOption = data->GetDrawingOptionAlias();
@@ -339,9 +395,12 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
                 } else if constexpr (is_hist_1d<data_type>()) {
                   data_ptr->GetYaxis()->SetTitle("ratio");
                 }
+              } else if constexpr (is_hist_1d<data_type>() && is_graph_1d<denom_data_type>()) {
+                WARNING("Dividing histogram by graph via spline interpolation. Errors will not be fully correct!");
+                DivideHistGraphInterpolated(data_ptr, denom_data_ptr);
+                data_ptr->GetYaxis()->SetTitle("ratio");
               } else if constexpr (is_graph<denom_data_type>()) {
                 ERROR("Cannot divide histogram by graph.");
-                // DivideHistGraphInterpolated(data_ptr, denom_data_ptr);
               }
             } else if constexpr (is_graph_1d<data_type>()) {
               if constexpr (is_graph_1d<denom_data_type>()) {
@@ -351,8 +410,8 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
                   DivideGraphsInterpolated(data_ptr, denom_data_ptr);
                 }
               } else if constexpr (is_hist_1d<denom_data_type>()) {
-                ERROR("Cannot divide graph by histogram.");
-                // DivideGraphHistInterpolated(data_ptr, denom_data_ptr);
+                WARNING("Dividing graph by histogram via spline interpolation. Errors will not be fully correct!");
+                DivideGraphHistInterpolated(data_ptr, denom_data_ptr);
               }
               data_ptr->GetHistogram()->GetYaxis()->SetTitle("ratio");
             } else {
@@ -380,7 +439,8 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
           }
         }
         if constexpr (is_hist<data_type>()) {
-          if (!data_ptr->GetSumw2N()) data_ptr->Sumw2();
+          // borrowed histograms have Sumw2 already (see RequiresDataClone)
+          if (!isBorrowed && !data_ptr->GetSumw2N()) data_ptr->Sumw2();
           optional<double_t> scaleFactor;
           string scaleMode{};
 
@@ -679,7 +739,7 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
           if (auto& fillOpacity = get_first(data->GetFillOpacity(),
                                             pad.GetDefaultFillOpacity(),
                                             padDefaults.GetDefaultFillOpacity())) {
-            data_ptr->SetFillColor(TColor::GetColorTransparent(data_ptr->GetFillColor(), *fillOpacity));
+            data_ptr->SetFillColor(GetTransparentColor(data_ptr->GetFillColor(), *fillOpacity));
           }
 
           // now define data ranges
@@ -723,12 +783,22 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
           }
           if (data->GetTextFormat()) gStyle->SetPaintTextFormat((*data->GetTextFormat()).data());
 
+          // reduce the points to what the pad can resolve once ranges, ratios and scaling are applied
+          if (data->GetDecimation() && *data->GetDecimation()) {
+            if constexpr (is_graph_1d<data_type>()) {
+              DecimateGraph(static_cast<TGraph*>(data_ptr), GetPixelColumns(pad_ptr, axisHist_ptr));
+            } else if constexpr (is_hist_1d<data_type>()) {
+              DecimateHist(data_ptr, GetPixelColumns(pad_ptr, axisHist_ptr));
+            }
+          }
+
           // disallow moving around the points of a graph in interacitve mode
           if constexpr (is_graph_1d<data_type>()) {
             data_ptr->SetEditable(false);
           }
 
           data_ptr->Draw(drawingOptions.data());
+          mDrawnData[{padID, dataIndex}] = data_ptr;
 
           // in case a label was specified for the data, add it to corresponding legend
           auto& legendBoxVector = pad.GetLegendBoxes();
@@ -739,7 +809,8 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
             if (data->GetLegendID()) legendID = *data->GetLegendID();
 
             if (legendID > 0u && legendID <= legendBoxVector.size()) {
-              legendBoxVector[legendID - 1]->AddEntry(*data->GetLegendLabel(), data_ptr->GetName());
+              MakePrivate(legendBoxVector[legendID - 1]);
+              legendBoxVector[legendID - 1]->AddEntry(*data->GetLegendLabel(), data_ptr->GetName(), data->GetLegendLabelTemplate());
             } else {
               ERROR("Invalid legend label ({}) specified for data {} in {}.", legendID, data->GetName(), data->GetInputID());
             }
@@ -750,7 +821,11 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
         drawingOptions = "SAME "; // next data should be drawn to same pad
       };
 
-      optional<data_ptr_t> rawData = GetDataClone(dataBuffer.at(data->GetInputID()).at(data->GetName()).get(), data->GetProjInfo());
+      TObject* bufferedData = dataBuffer.at(data->GetInputID()).at(data->GetName()).get();
+      // projections are taken from the cache and can then be treated like any other buffered data
+      if (bufferedData && data->GetProjInfo()) bufferedData = GetCachedProjection(bufferedData, *data->GetProjInfo());
+      isBorrowed = !RequiresDataClone(*data, bufferedData, dataIndex, drawingOptions);
+      optional<data_ptr_t> rawData = (isBorrowed) ? GetDataView(bufferedData) : GetDataClone(bufferedData);
       if (rawData) {
         std::visit(processData, *rawData);
       } else {
@@ -787,6 +862,7 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
     uint8_t legendIndex{1u};
     for (auto& box : pad.GetLegendBoxes()) {
       string legendName = "LegendBox_" + std::to_string(legendIndex);
+      if (!box->mLegendEntriesUser.empty() || (!box->GetTextFont() && textFont) || (!box->GetTextSize() && textSize) || (!box->GetTextColor() && textColor)) MakePrivate(box);
       box->MergeLegendEntries(); // apply individual user settings on top of automatic entries
       // apply default text properties of pad to the box
       if (!box->GetTextFont() && textFont) box->SetTextFont(*textFont);
@@ -804,6 +880,7 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
     uint8_t textIndex{1u};
     for (auto& box : pad.GetTextBoxes()) {
       string textName = "TextBox_" + std::to_string(textIndex);
+      if ((!box->GetTextFont() && textFont) || (!box->GetTextSize() && textSize) || (!box->GetTextColor() && textColor)) MakePrivate(box);
       // apply default text properties of pad to the box
       if (!box->GetTextFont() && textFont) box->SetTextFont(*textFont);
       if (!box->GetTextSize() && textSize) box->SetTextSize(*textSize);
@@ -835,6 +912,7 @@ unique_ptr<TCanvas> PlotPainter::GeneratePlot(Plot& plot, const unordered_map<st
 //**************************************************************************************************
 TPave* PlotPainter::GenerateBox(variant<shared_ptr<Plot::Pad::LegendBox>, shared_ptr<Plot::Pad::TextBox>> boxVariant, TPad* pad)
 {
+  PROFILE_SCOPE("paint", "GenerateBox");
   TPave* returnBox{nullptr};
 
   auto processBox = [&](auto&& box) {
@@ -902,8 +980,11 @@ TPave* PlotPainter::GenerateBox(variant<shared_ptr<Plot::Pad::LegendBox>, shared
         if (entry.GetRefDataName()) {
           // FIXME: this gives always the first -> problem when drawing the same histogram twice!
           TNamed* data_ptr = static_cast<TNamed*>(pad->FindObject(entry.GetRefDataName()->data()));
-          if (!data_ptr) ERROR("Object belonging to legend entry {} not found.", line);
-          ReplacePlaceholders(line, data_ptr);
+          if (!data_ptr) {
+            ERROR("Object belonging to legend entry {} not found.", line);
+          } else if (entry.GetLabelTemplate()) {
+            line = FillPlaceholders(*entry.GetLabelTemplate(), data_ptr);
+          }
         }
       }
 
@@ -1101,7 +1182,7 @@ TPave* PlotPainter::GenerateBox(variant<shared_ptr<Plot::Pad::LegendBox>, shared
 
         if (entry.GetFillColor()) curEntry->SetFillColor(*entry.GetFillColor());
         if (entry.GetFillStyle()) curEntry->SetFillStyle(*entry.GetFillStyle());
-        if (entry.GetFillOpacity() && entry.GetFillColor()) curEntry->SetFillColor(TColor::GetColorTransparent(*entry.GetFillColor(), *entry.GetFillOpacity()));
+        if (entry.GetFillOpacity() && entry.GetFillColor()) curEntry->SetFillColor(GetTransparentColor(*entry.GetFillColor(), *entry.GetFillOpacity()));
 
         if (entry.GetTextColor()) curEntry->SetTextColor(*entry.GetTextColor());
         if (entry.GetTextFont()) curEntry->SetTextFont(*entry.GetTextFont());
@@ -1147,7 +1228,7 @@ TPave* PlotPainter::GenerateBox(variant<shared_ptr<Plot::Pad::LegendBox>, shared
         returnBox->SetFillStyle(0); // TODO: steer via pad defaults
       }
       if (fillColor) returnBox->SetFillColor(*fillColor);
-      if (fillOpacity && fillColor) returnBox->SetFillColor(TColor::GetColorTransparent(*fillColor, *fillOpacity));
+      if (fillOpacity && fillColor) returnBox->SetFillColor(GetTransparentColor(*fillColor, *fillOpacity));
     }
   };
   std::visit(processBox, boxVariant);
@@ -1161,45 +1242,373 @@ TPave* PlotPainter::GenerateBox(variant<shared_ptr<Plot::Pad::LegendBox>, shared
 //**************************************************************************************************
 optional<data_ptr_t> PlotPainter::GetDataClone(TObject* obj, const optional<Plot::Pad::Data::proj_info_t>& projInfo)
 {
+  if (obj && projInfo) obj = GetCachedProjection(obj, *projInfo);
   if (obj) {
-    if (projInfo) {
-      bool addDirStatus = TH1::AddDirectoryStatus();
-      TH1::AddDirectory(false);
-      string name = obj->GetName();
-      name += projInfo->GetNameSuffix();
-      if (auto returnPointer = GetProjection(obj, *projInfo)) {
-        std::visit([&name](auto&& ptr) { ptr->SetName(name.data()); }, *returnPointer);
-        TH1::AddDirectory(addDirStatus);
-        return returnPointer;
-      } else {
-        ERROR("Projection failed for {}.", obj->GetName());
-      }
+    // TProfile2D is TH2, TH2 is TH1, TProfile is TH1
+    if (auto returnPointer = GetDataClone<TProfile2D, TH2, TProfile, TH1, TGraph2D, TGraph, TF2, TF1>(obj)) {
+      return returnPointer;
     } else {
-      // TProfile2D is TH2, TH2 is TH1, TProfile is TH1
-      if (auto returnPointer = GetDataClone<TProfile2D, TH2, TProfile, TH1, TGraph2D, TGraph, TF2, TF1>(obj)) {
-        return returnPointer;
-      } else {
-        ERROR("Input data {} is of unsupported type {}.", obj->GetName(), obj->ClassName());
-      }
+      ERROR("Input data {} is of unsupported type {}.", obj->GetName(), obj->ClassName());
     }
   }
   return nullopt;
 }
 
 template <typename T>
-optional<data_ptr_t> PlotPainter::GetDataClone(TObject* obj)
+optional<data_ptr_t> PlotPainter::GetDataClone(TObject* obj, bool borrow)
 {
   if (obj && obj->InheritsFrom(T::Class())) {
-    return static_cast<T*>(obj->Clone());
+    return static_cast<T*>((borrow) ? obj : obj->Clone());
   }
   return nullopt;
 }
 
 template <typename T, typename Next, typename... Rest>
-optional<data_ptr_t> PlotPainter::GetDataClone(TObject* obj)
+optional<data_ptr_t> PlotPainter::GetDataClone(TObject* obj, bool borrow)
+{
+  if (auto returnPointer = GetDataClone<T>(obj, borrow)) return returnPointer;
+  return GetDataClone<Next, Rest...>(obj, borrow);
+}
+
+//**************************************************************************************************
+/**
+ * Function to retrieve the stored data itself properly casted to its actual ROOT type.
+ */
+//**************************************************************************************************
+optional<data_ptr_t> PlotPainter::GetDataView(TObject* obj)
+{
+  // TProfile2D is TH2, TH2 is TH1, TProfile is TH1
+  if (auto returnPointer = GetDataClone<TProfile2D, TH2, TProfile, TH1, TGraph>(obj, true)) {
+    return returnPointer;
+  }
+  ERROR("Input data {} cannot be drawn without copying it.", obj->GetName());
+  return nullopt;
+}
+
+//**************************************************************************************************
+/**
+ * Returns the canvas generated last to the layout pool, such that the next plot with the same layout can re-use it.
+ */
+//**************************************************************************************************
+void PlotPainter::RecycleCanvas(unique_ptr<TCanvas> canvas)
+{
+  if (!mLayoutPool || mLayout.empty() || !canvas) return;
+  // the pads are emptied right away since the drawn data may be deleted before the canvas is used again
+  TIter next(canvas->GetListOfPrimitives());
+  while (TObject* object = next()) {
+    if (object->InheritsFrom(TPad::Class())) static_cast<TPad*>(object)->Clear();
+  }
+  mLayoutPool->Release(mLayout, std::move(canvas));
+  mLayout.clear();
+}
+
+//**************************************************************************************************
+/**
+ * Identifier of the canvas and pad settings of a plot. Plots with the same layout can be drawn on the same canvas.
+ */
+//**************************************************************************************************
+string PlotPainter::GetLayout(Plot& plot)
+{
+  auto value = [](const auto& setting) { return (setting) ? fmt::format("{}", *setting) : string("-"); };
+  string layout = fmt::format("{}|{}|{}|{}|{}|{}", value(plot.GetWidth()), value(plot.GetHeight()), value(plot.GetFillColor()), value(plot.GetFillStyle()), value(plot.GetFillOpacity()), value(plot.IsFixAspectRatio()));
+  auto& padDefaults = plot[0];
+  for (auto& [padID, pad] : plot.GetPads()) {
+    if (padID == 0) continue;
+    layout += fmt::format("|{}:{},{},{},{}", padID, value(pad.GetXLow()), value(pad.GetYLow()), value(pad.GetXUp()), value(pad.GetYUp()));
+    for (auto& setting : {get_first(pad.GetMarginTop(), padDefaults.GetMarginTop()), get_first(pad.GetMarginBottom(), padDefaults.GetMarginBottom()),
+                          get_first(pad.GetMarginLeft(), padDefaults.GetMarginLeft()), get_first(pad.GetMarginRight(), padDefaults.GetMarginRight()),
+                          get_first(pad.GetFillOpacity(), padDefaults.GetFillOpacity()), get_first(pad.GetFrameFillOpacity(), padDefaults.GetFrameFillOpacity()),
+                          get_first(pad.GetFrameBorderWidth(), padDefaults.GetFrameBorderWidth())}) {
+      layout += "," + value(setting);
+    }
+    for (auto& setting : {get_first(pad.GetFillColor(), padDefaults.GetFillColor()), get_first(pad.GetFillStyle(), padDefaults.GetFillStyle()),
+                          get_first(pad.GetFrameFillColor(), padDefaults.GetFrameFillColor()), get_first(pad.GetFrameFillStyle(), padDefaults.GetFrameFillStyle()),
+                          get_first(pad.GetFrameBorderColor(), padDefaults.GetFrameBorderColor()), get_first(pad.GetFrameBorderStyle(), padDefaults.GetFrameBorderStyle())}) {
+      layout += "," + value(setting);
+    }
+  }
+  return layout;
+}
+
+//**************************************************************************************************
+/**
+ * Replaces the content of the data drawn in the canvas created last by the data requested in plot, while keeping layout,
+ * axes, boxes and appearance (used for the frames of animations). The plot must have the same structure as the one
+ * painted before. Returns false in case the data cannot simply be exchanged (e.g. ratios, smoothing, decimation, label placeholders or
+ * different binning) and the plot therefore has to be generated again.
+ */
+//**************************************************************************************************
+bool PlotPainter::UpdateData(TCanvas& canvas, const Plot& plot, const unordered_map<string, unordered_map<string, unique_ptr<TObject>>>& dataBuffer)
 {
-  if (auto returnPointer = GetDataClone<T>(obj)) return returnPointer;
-  return GetDataClone<Next, Rest...>(obj);
+  PROFILE_SCOPE("paint", "UpdateData");
+  for (auto& [padID, pad] : plot.GetPads()) {
+    if (padID == 0) continue;
+    uint16_t dataIndex{1u};
+    for (auto& data : pad.GetData()) {
+      auto drawnData = mDrawnData.find({padID, dataIndex++});
+      if (drawnData == mDrawnData.end()) return false;
+      if (data->GetType() == "ratio" || data->GetLegendLabelTemplate()) return false;
+      if (data->GetDrawingOptions() && str_contains(*data->GetDrawingOptions(), "smooth")) return false;
+      if (data->GetDecimation() && *data->GetDecimation()) return false;
+
+      auto input = dataBuffer.find(data->GetInputID());
+      if (input == dataBuffer.end()) return false;
+      auto bufferedData = input->second.find(data->GetName());
+      if (bufferedData == input->second.end() || !bufferedData->second) return false;
+      TObject* source = bufferedData->second.get();
+      if (data->GetProjInfo()) source = GetCachedProjection(source, *data->GetProjInfo());
+      if (!source) return false;
+
+      // same scaling as for a freshly generated plot
+      double_t scale{1.};
+      if (data->GetNormMode()) {
+        double_t integral{};
+        if (source->InheritsFrom(TH1::Class())) {
+          integral = static_cast<TH1*>(source)->Integral((*data->GetNormMode() > 0) ? "width" : "");
+        } else if (source->InheritsFrom(TGraph::Class())) {
+          integral = static_cast<TGraph*>(source)->Integral();
+        }
+        if (integral == 0.) return false;
+        scale = 1. / integral;
+      }
+      if (data->GetScaleFactor()) scale *= *data->GetScaleFactor();
+      if (!CopyContent(drawnData->second, source, scale)) return false;
+      if (auto graph = dynamic_cast<TGraph*>(drawnData->second); graph && (data->GetMinRangeX() || data->GetMaxRangeX())) {
+        SetGraphRange(graph, data->GetMinRangeX(), data->GetMaxRangeX());
+      }
+    }
+  }
+  TIter next(canvas.GetListOfPrimitives());
+  while (TObject* object = next()) {
+    if (object->InheritsFrom(TPad::Class())) static_cast<TPad*>(object)->Modified();
+  }
+  canvas.Modified();
+  canvas.Update();
+  return true;
+}
+
+//**************************************************************************************************
+/**
+ * Copies bin contents or points (scaled) from source to target, which must be of the same type and binning.
+ */
+//**************************************************************************************************
+bool PlotPainter::CopyContent(TObject* target, const TObject* source, double_t scale)
+{
+  if (target->InheritsFrom(TH1::Class()) && source->InheritsFrom(TH1::Class())) {
+    auto targetHist = static_cast<TH1*>(target);
+    auto sourceHist = static_cast<const TH1*>(source);
+    // bin contents of profiles are derived quantities and cannot be set directly
+    if (targetHist->InheritsFrom("TProfile") || sourceHist->InheritsFrom("TProfile")) return false;
+    if (targetHist->GetDimension() != sourceHist->GetDimension() || targetHist->GetNcells() != sourceHist->GetNcells()) return false;
+    for (int32_t cell = 0; cell < sourceHist->GetNcells(); ++cell) {
+      targetHist->SetBinContent(cell, sourceHist->GetBinContent(cell) * scale);
+      targetHist->SetBinError(cell, sourceHist->GetBinError(cell) * scale);
+    }
+    targetHist->SetEntries(sourceHist->GetEntries());
+    return true;
+  }
+  if (target->InheritsFrom(TGraph::Class()) && source->IsA() == target->IsA()) {
+    auto targetGraph = static_cast<TGraph*>(target);
+    auto sourceGraph = static_cast<const TGraph*>(source);
+    int32_t nPoints = sourceGraph->GetN();
+    targetGraph->Set(nPoints);
+    if (nPoints == 0) return true;
+    std::copy_n(sourceGraph->GetX(), nPoints, targetGraph->GetX());
+    std::transform(sourceGraph->GetY(), sourceGraph->GetY() + nPoints, targetGraph->GetY(), [scale](double_t y) { return y * scale; });
+    for (auto [sourceError, targetError] : {std::pair{sourceGraph->GetEX(), targetGraph->GetEX()}, {sourceGraph->GetEXlow(), targetGraph->GetEXlow()}, {sourceGraph->GetEXhigh(), targetGraph->GetEXhigh()}}) {
+      if (sourceError && targetError) std::copy_n(sourceError, nPoints, targetError);
+    }
+    for (auto [sourceError, targetError] : {std::pair{sourceGraph->GetEY(), targetGraph->GetEY()}, {sourceGraph->GetEYlow(), targetGraph->GetEYlow()}, {sourceGraph->GetEYhigh(), targetGraph->GetEYhigh()}}) {
+      if (sourceError && targetError) std::transform(sourceError, sourceError + nPoints, targetError, [scale](double_t ey) { return ey * std::abs(scale); });
+    }
+    return true;
+  }
+  return false;
+}
+
+//**************************************************************************************************
+/**
+ * Decides if the data need a private copy or can be drawn directly from the buffer.
+ * A copy is needed whenever the content of the data is modified (ratio, scaling, normalization,
+ * smoothing, decimation, range cut for graphs, Sumw2 for histograms) or when the data serve as axis frame. Cached projections are
+ * treated the same way as data from the buffer.
+ */
+//**************************************************************************************************
+bool PlotPainter::RequiresDataClone(const Plot::Pad::Data& data, const TObject* obj, uint16_t dataIndex, const string& drawingOptions) const
+{
+  if (!mBorrowData || !obj || dataIndex == 0) return true;
+  if (data.GetType() == "ratio") return true;
+  if (data.GetNormMode() || data.GetScaleFactor()) return true;
+  if (str_contains(drawingOptions, "smooth")) return true;
+  if (data.GetDecimation() && *data.GetDecimation()) return true;
+  // the same data can only be borrowed once per plot since each usage has its own appearance
+  if (mBorrowedData.find(obj) != mBorrowedData.end()) return true;
+  // histograms with Sumw2 are drawn with error bars by default, so the copy would look different otherwise
+  if (obj->InheritsFrom(TH1::Class())) return (static_cast<const TH1*>(obj)->GetSumw2N() == 0);
+  if (obj->InheritsFrom(TGraph::Class())) return (data.GetMinRangeX() || data.GetMaxRangeX());
+  return true;
+}
+
+//**************************************************************************************************
+/**
+ * Boxes may still be shared with the plot definitions (e.g. those of a plot template) and are therefore copied
+ * before the painter adds legend entries or default text properties to them.
+ */
+//**************************************************************************************************
+template <typename BoxType>
+void PlotPainter::MakePrivate(shared_ptr<BoxType>& box)
+{
+  if (mPrivateBoxes.find(box.get()) != mPrivateBoxes.end()) return;
+  box = std::make_shared<BoxType>(*box);
+  mPrivateBoxes.insert(box.get());
+}
+
+//**************************************************************************************************
+/**
+ * Remembers the state of borrowed data that is changed while drawing them so it can be restored afterwards.
+ */
+//**************************************************************************************************
+template <typename T>
+void PlotPainter::BorrowData(T data_ptr)
+{
+  if constexpr (is_hist<T>() || is_graph_1d<T>()) {
+    mBorrowedData.insert(data_ptr);
+    string name = data_ptr->GetName();
+    string title = data_ptr->GetTitle();
+    TAttLine lineAtt;
+    TAttFill fillAtt;
+    TAttMarker markerAtt;
+    data_ptr->TAttLine::Copy(lineAtt);
+    data_ptr->TAttFill::Copy(fillAtt);
+    data_ptr->TAttMarker::Copy(markerAtt);
+
+    if constexpr (is_hist<T>()) {
+      double_t min = data_ptr->GetMinimumStored();
+      double_t max = data_ptr->GetMaximumStored();
+      array<int32_t, 4> axisRanges = {data_ptr->GetXaxis()->GetFirst(), data_ptr->GetXaxis()->GetLast(),
+                                      data_ptr->GetYaxis()->GetFirst(), data_ptr->GetYaxis()->GetLast()};
+      vector<double_t> contours(data_ptr->GetContour());
+      if (!contours.empty()) data_ptr->GetContour(contours.data());
+      mRestoreBorrowedData.push_back([=]() {
+        data_ptr->SetName(name.data());
+        data_ptr->SetTitle(title.data());
+        lineAtt.Copy(*data_ptr);
+        fillAtt.Copy(*data_ptr);
+        markerAtt.Copy(*data_ptr);
+        data_ptr->SetMinimum(min);
+        data_ptr->SetMaximum(max);
+        data_ptr->GetXaxis()->SetRange(axisRanges[0], axisRanges[1]);
+        data_ptr->GetYaxis()->SetRange(axisRanges[2], axisRanges[3]);
+        data_ptr->SetContour(contours.size(), (contours.empty()) ? nullptr : contours.data());
+      });
+    } else {
+      double_t min = data_ptr->GetMinimum();
+      double_t max = data_ptr->GetMaximum();
+      bool isEditable = data_ptr->GetEditable();
+      mRestoreBorrowedData.push_back([=]() {
+        data_ptr->SetName(name.data());
+        data_ptr->SetTitle(title.data());
+        lineAtt.Copy(*data_ptr);
+        fillAtt.Copy(*data_ptr);
+        markerAtt.Copy(*data_ptr);
+        data_ptr->SetMinimum(min);
+        data_ptr->SetMaximum(max);
+        data_ptr->SetEditable(isEditable);
+      });
+    }
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Retrieves a projection of the data from the cache and computes it in case it was not requested before.
+ * The projection remains owned by the cache.
+ */
+//**************************************************************************************************
+TObject* PlotPainter::GetCachedProjection(TObject* obj, const Plot::Pad::Data::proj_info_t& projInfo)
+{
+  if (!obj) return nullptr;
+  projection_cache_t::key_t key{obj, projInfo.dims, projInfo.ranges, projInfo.isUserCoord.value_or(false), projInfo.isProfile.value_or(false)};
+  {
+    std::lock_guard<std::mutex> lock(mProjectionCache->mutex);
+    if (auto cachedProjection = mProjectionCache->projections.find(key); cachedProjection != mProjectionCache->projections.end()) {
+      return cachedProjection->second.get();
+    }
+  }
+
+  bool addDirStatus = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(false);
+  TObject* projection{nullptr};
+  if (auto returnPointer = GetProjection(obj, projInfo)) {
+    string name = obj->GetName();
+    name += projInfo.GetNameSuffix();
+    projection = std::visit([&name](auto&& ptr) -> TObject* { ptr->SetName(name.data()); return ptr; }, *returnPointer);
+  } else {
+    ERROR("Projection failed for {}.", obj->GetName());
+  }
+  TH1::AddDirectory(addDirStatus);
+  if (!projection) return nullptr;
+
+  std::lock_guard<std::mutex> lock(mProjectionCache->mutex);
+  auto& cachedProjection = mProjectionCache->projections[key];
+  if (cachedProjection) {
+    delete projection; // was computed in the meantime
+  } else {
+    cachedProjection.reset(projection);
+  }
+  return cachedProjection.get();
+}
+
+//**************************************************************************************************
+/**
+ * Removes the projections of data that are about to be deleted.
+ */
+//**************************************************************************************************
+void projection_cache_t::Release(const TObject* source)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = projections.begin(); it != projections.end();) {
+    it = (std::get<0>(it->first) == source) ? projections.erase(it) : std::next(it);
+  }
+}
+
+void projection_cache_t::Clear()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  projections.clear();
+}
+
+//**************************************************************************************************
+/**
+ * Take canvas with the requested layout from the pool (nullptr if there is none).
+ */
+//**************************************************************************************************
+unique_ptr<TCanvas> layout_pool_t::Acquire(const string& layout)
+{
+  auto pooled = canvases.find(layout);
+  if (pooled == canvases.end() || pooled->second.empty()) return nullptr;
+  unique_ptr<TCanvas> canvas = std::move(pooled->second.back());
+  pooled->second.pop_back();
+  --nCanvases;
+  return canvas;
+}
+
+//**************************************************************************************************
+/**
+ * Put canvas back in the pool. Canvases beyond the capacity of the pool are deleted.
+ */
+//**************************************************************************************************
+void layout_pool_t::Release(const string& layout, unique_ptr<TCanvas> canvas)
+{
+  if (!canvas || nCanvases >= maxCanvases) return;
+  canvases[layout].push_back(std::move(canvas));
+  ++nCanvases;
+}
+
+void layout_pool_t::Clear()
+{
+  canvases.clear();
+  nCanvases = 0u;
 }
 
 optional<data_ptr_t> PlotPainter::GetProjection(TObject* obj, Plot::Pad::Data::proj_info_t projInfo)
@@ -1336,20 +1745,10 @@ string PlotPainter::GetAxisStr(int16_t i)
 bool PlotPainter::DivideGraphs(TGraph* numerator, TGraph* denominator)
 {
   // first check if graphs indeed have the same x values
-  for (int32_t i = 0; i < numerator->GetN(); ++i) {
-    if (numerator->GetX()[i] != denominator->GetX()[i]) return false;
-  }
-  for (int32_t i = 0; i < numerator->GetN(); ++i) {
-    double_t num = numerator->GetY()[i];
-    double_t denom = denominator->GetY()[i];
-    double_t numErr = numerator->GetEY()[i];
-    double_t denomErr = denominator->GetEY()[i];
-    if (!denom) {
-      ERROR("Dividing by zero!");
-    }
-    numerator->GetY()[i] = (denom) ? num / denom : 0.;
-    numerator->GetEY()[i] = (denom) ? std::sqrt(std::pow(1 / denom, 2) * std::pow(numErr, 2) + std::pow(num / std::pow(denom, 2), 2) * std::pow(denomErr, 2)) : 0.;
-  }
+  int32_t nPoints = numerator->GetN();
+  if (nPoints != denominator->GetN() || !std::equal(numerator->GetX(), numerator->GetX() + nPoints, denominator->GetX())) return false;
+  error_arrays_t denomErrors = GetErrorsY(denominator);
+  DivideArrays(nPoints, numerator->GetY(), GetErrorsY(numerator), denominator->GetY(), denomErrors.low, denomErrors.high);
   return true;
 }
 
@@ -1361,27 +1760,7 @@ bool PlotPainter::DivideGraphs(TGraph* numerator, TGraph* denominator)
 //**************************************************************************************************
 void PlotPainter::DivideGraphsInterpolated(TGraph* numerator, TGraph* denominator)
 {
-  TSpline3 denSpline("denSpline", denominator);
-
-  int32_t nPoints = numerator->GetN();
-
-  double_t* x = numerator->GetX();
-  double_t* y = numerator->GetY();
-  double_t* ey = numerator->GetEY();
-
-  for (int32_t i = 0; i < nPoints; ++i) {
-    double_t denomValue = denominator->Eval(x[i], &denSpline);
-    double_t newValue = 0.;
-    double_t newError = 0.;
-    if (denomValue) {
-      newValue = y[i] / denomValue;
-      newError = ey[i] / denomValue; // Only proxy. Ignoring error of denominator!
-    } else {
-      ERROR("Dividing by zero!");
-    }
-    y[i] = newValue;
-    ey[i] = newError;
-  }
+  DivideInterpolated(numerator->GetN(), numerator->GetX(), numerator->GetY(), GetErrorsY(numerator), GetPoints(denominator));
 }
 
 //**************************************************************************************************
@@ -1392,9 +1771,9 @@ void PlotPainter::DivideGraphsInterpolated(TGraph* numerator, TGraph* denominato
 //**************************************************************************************************
 void PlotPainter::DivideHistGraphInterpolated(TH1* numerator, TGraph* denominator)
 {
-  TGraph numeratorGraph(numerator);
-  DivideGraphsInterpolated(&numeratorGraph, denominator);
-  // FIXME: numerator graph must be put in hist afterwards!
+  points_t points = GetPoints(numerator);
+  DivideInterpolated(points.x.size(), points.x.data(), points.y.data(), {points.eyLow.data(), points.eyLow.data()}, GetPoints(denominator));
+  SetPoints(numerator, points);
 }
 
 //**************************************************************************************************
@@ -1405,8 +1784,7 @@ void PlotPainter::DivideHistGraphInterpolated(TH1* numerator, TGraph* denominato
 //**************************************************************************************************
 void PlotPainter::DivideGraphHistInterpolated(TGraph* numerator, TH1* denominator)
 {
-  TGraph denominatorGraph(denominator);
-  DivideGraphsInterpolated(numerator, &denominatorGraph);
+  DivideInterpolated(numerator->GetN(), numerator->GetX(), numerator->GetY(), GetErrorsY(numerator), GetPoints(denominator));
 }
 
 //**************************************************************************************************
@@ -1417,25 +1795,169 @@ void PlotPainter::DivideGraphHistInterpolated(TGraph* numerator, TH1* denominato
 //**************************************************************************************************
 void PlotPainter::DivideHistosInterpolated(TH1* numerator, TH1* denominator)
 {
-  TGraph denominatorGraph(denominator);
-  TSpline3 denominatorSpline(denominator);
-
-  for (int32_t i = 1; i <= numerator->GetNbinsX(); ++i) {
-    double_t numeratorValue{numerator->GetBinContent(i)};
-    double_t numeratorError{numerator->GetBinError(i)};
-    double_t x{numerator->GetBinCenter(i)};
-    double_t denomValue{denominatorGraph.Eval(x, &denominatorSpline)};
-    double_t newValue{};
-    double_t newError{};
-    if (denomValue) {
-      newValue = numeratorValue / denomValue;
-      // uncertainty of denominator is not taken into account (cannot be extracted from spline)
-      newError = numeratorError / denomValue;
-    } else {
-      // ERROR("Dividing by zero in bin {}!", i);
+  points_t points = GetPoints(numerator);
+  DivideInterpolated(points.x.size(), points.x.data(), points.y.data(), {points.eyLow.data(), points.eyLow.data()}, GetPoints(denominator));
+  SetPoints(numerator, points);
+}
+
+//**************************************************************************************************
+/**
+ * Divides values (and their errors) by the denominator interpolated at the positions x.
+ * The denominator values are interpolated via cubic spline, their errors linearly.
+ * Both x and the denominator points are expected to be sorted, such that a single pass over both is sufficient.
+ */
+//**************************************************************************************************
+void PlotPainter::DivideInterpolated(int32_t nPoints, const double_t* x, double_t* values, error_arrays_t errors, points_t denominator)
+{
+  int32_t nKnots = denominator.x.size();
+  if (nKnots < 2) {
+    ERROR("Cannot interpolate denominator with less than two points.");
+    return;
+  }
+  // the spline only provides the coefficients here, its evaluation would search the segment of each point again
+  TSpline3 spline("denominator", denominator.x.data(), denominator.y.data(), nKnots);
+  vector<double_t> b(nKnots), c(nKnots), d(nKnots);
+  for (int32_t j = 0; j < nKnots; ++j) {
+    spline.GetCoeff(j, denominator.x[j], denominator.y[j], b[j], c[j], d[j]);
+  }
+
+  // segment of each point (points outside the range are extrapolated with the first or last segment)
+  vector<int32_t> segments(nPoints);
+  int32_t segment{0};
+  for (int32_t i = 0; i < nPoints; ++i) {
+    if (i > 0 && x[i] < x[i - 1]) {
+      segment = std::max<int32_t>(std::upper_bound(denominator.x.begin(), denominator.x.end(), x[i]) - denominator.x.begin() - 1, 0);
+    }
+    while (segment + 1 < nKnots && denominator.x[segment + 1] <= x[i]) {
+      ++segment;
+    }
+    segments[i] = segment;
+  }
+
+  vector<double_t> denomValues(nPoints);
+  vector<double_t> denomErrorsLow(nPoints);
+  vector<double_t> denomErrorsHigh(nPoints);
+  for (int32_t i = 0; i < nPoints; ++i) {
+    int32_t j = segments[i];
+    double_t dx = x[i] - denominator.x[j];
+    denomValues[i] = denominator.y[j] + dx * (b[j] + dx * (c[j] + dx * d[j]));
+  }
+  for (int32_t i = 0; i < nPoints; ++i) {
+    int32_t j = std::min(segments[i], nKnots - 2);
+    double_t t = std::clamp((x[i] - denominator.x[j]) / (denominator.x[j + 1] - denominator.x[j]), 0., 1.);
+    denomErrorsLow[i] = (1. - t) * denominator.eyLow[j] + t * denominator.eyLow[j + 1];
+    denomErrorsHigh[i] = (1. - t) * denominator.eyHigh[j] + t * denominator.eyHigh[j + 1];
+  }
+  DivideArrays(nPoints, values, errors, denomValues.data(), denomErrorsLow.data(), denomErrorsHigh.data());
+}
+
+//**************************************************************************************************
+/**
+ * Divides values by the denominator values and propagates the (uncorrelated) errors. Lower and upper errors are propagated
+ * separately: e.g. the lower error of a positive ratio combines the lower error of the numerator with the upper error of the
+ * denominator. Symmetric numerator errors are combined with the mean of the denominator errors.
+ * The error arrays and the denominator errors may be nullptr.
+ */
+//**************************************************************************************************
+void PlotPainter::DivideArrays(int32_t nPoints, double_t* values, error_arrays_t errors, const double_t* denomValues, const double_t* denomErrorsLow, const double_t* denomErrorsHigh)
+{
+  vector<double_t> inverse(nPoints);
+  int32_t nZeros{};
+  for (int32_t i = 0; i < nPoints; ++i) {
+    nZeros += (denomValues[i] == 0.);
+    inverse[i] = (denomValues[i] != 0.) ? 1. / denomValues[i] : 0.;
+  }
+  if (nZeros) ERROR("Dividing by zero in {} point{}!", nZeros, (nZeros == 1) ? "" : "s");
+  for (int32_t i = 0; i < nPoints; ++i) {
+    values[i] *= inverse[i];
+  }
+  if (!denomErrorsLow) denomErrorsLow = denomErrorsHigh;
+  if (!denomErrorsHigh) denomErrorsHigh = denomErrorsLow;
+
+  // relative to the ratio: sqrt(numErr^2 + ratio^2 * denomErr^2) / |denom|
+  auto propagate = [&](double_t* error, int32_t i, double_t denomError) {
+    double_t denomTerm = values[i] * denomError;
+    error[i] = std::sqrt(error[i] * error[i] + denomTerm * denomTerm) * std::abs(inverse[i]);
+  };
+  if (errors.low == errors.high) {
+    if (!errors.low) return;
+    for (int32_t i = 0; i < nPoints; ++i) {
+      propagate(errors.low, i, (denomErrorsLow) ? 0.5 * (denomErrorsLow[i] + denomErrorsHigh[i]) : 0.);
     }
-    numerator->SetBinContent(i, newValue);
-    numerator->SetBinError(i, newError);
+    return;
+  }
+  for (int32_t i = 0; i < nPoints; ++i) {
+    // an increase of the denominator lowers the ratio if ratio and denominator have the same sign
+    bool isFalling = (values[i] * denomValues[i] >= 0.);
+    double_t denomErrorDown = (!denomErrorsLow) ? 0. : (isFalling) ? denomErrorsHigh[i] : denomErrorsLow[i];
+    double_t denomErrorUp = (!denomErrorsLow) ? 0. : (isFalling) ? denomErrorsLow[i] : denomErrorsHigh[i];
+    if (errors.low) propagate(errors.low, i, denomErrorDown);
+    if (errors.high) propagate(errors.high, i, denomErrorUp);
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Error arrays of the graph (symmetric or asymmetric, depending on the type).
+ */
+//**************************************************************************************************
+vector<double_t*> PlotPainter::GetErrorArrays(TGraph* graph)
+{
+  vector<double_t*> errors;
+  for (double_t* error : {graph->GetEY(), graph->GetEYlow(), graph->GetEYhigh()}) {
+    if (error) errors.push_back(error);
+  }
+  return errors;
+}
+
+//**************************************************************************************************
+/**
+ * Lower and upper y errors of the graph (the same array for symmetric errors, nullptr if the graph has no errors).
+ */
+//**************************************************************************************************
+PlotPainter::error_arrays_t PlotPainter::GetErrorsY(TGraph* graph)
+{
+  if (graph->GetEYlow() && graph->GetEYhigh()) return {graph->GetEYlow(), graph->GetEYhigh()};
+  return {graph->GetEY(), graph->GetEY()};
+}
+
+//**************************************************************************************************
+/**
+ * Contiguous copy of the points of a graph or the bins of a histogram (at their centers).
+ */
+//**************************************************************************************************
+PlotPainter::points_t PlotPainter::GetPoints(TGraph* graph)
+{
+  int32_t nPoints = graph->GetN();
+  points_t points{{graph->GetX(), graph->GetX() + nPoints}, {graph->GetY(), graph->GetY() + nPoints}, vector<double_t>(nPoints), vector<double_t>(nPoints)};
+  error_arrays_t errors = GetErrorsY(graph);
+  if (errors.low) points.eyLow.assign(errors.low, errors.low + nPoints);
+  if (errors.high) points.eyHigh.assign(errors.high, errors.high + nPoints);
+  return points;
+}
+PlotPainter::points_t PlotPainter::GetPoints(TH1* hist)
+{
+  int32_t nBins = hist->GetNbinsX();
+  points_t points{vector<double_t>(nBins), vector<double_t>(nBins), vector<double_t>(nBins), vector<double_t>(nBins)};
+  for (int32_t i = 0; i < nBins; ++i) {
+    points.x[i] = hist->GetBinCenter(i + 1);
+    points.y[i] = hist->GetBinContent(i + 1);
+    points.eyLow[i] = hist->GetBinError(i + 1);
+    points.eyHigh[i] = points.eyLow[i];
+  }
+  return points;
+}
+
+//**************************************************************************************************
+/**
+ * Write back bin contents and errors.
+ */
+//**************************************************************************************************
+void PlotPainter::SetPoints(TH1* hist, const points_t& points)
+{
+  for (size_t i = 0; i < points.y.size(); ++i) {
+    hist->SetBinContent(i + 1, points.y[i]);
+    hist->SetBinError(i + 1, points.eyLow[i]);
   }
 }
 
@@ -1476,10 +1998,158 @@ void PlotPainter::SetGraphRange(TGraph* graph, optional<double_t> min, optional<
 //**************************************************************************************************
 void PlotPainter::ScaleGraph(TGraph* graph, double_t scale)
 {
-  for (int32_t i{}; i < graph->GetN(); ++i) {
-    graph->GetY()[i] *= scale;
-    if (graph->GetEY()) graph->GetEY()[i] *= scale;
+  int32_t nPoints = graph->GetN();
+  for (double_t* values : GetErrorArrays(graph)) {
+    for (int32_t i = 0; i < nPoints; ++i) {
+      values[i] *= std::abs(scale);
+    }
+  }
+  double_t* values = graph->GetY();
+  for (int32_t i = 0; i < nPoints; ++i) {
+    values[i] *= scale;
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Pixel columns covered by the visible x range of the frame in the pad.
+ */
+//**************************************************************************************************
+PlotPainter::pixel_columns_t PlotPainter::GetPixelColumns(TPad* pad, TH1* axisHist)
+{
+  TAxis* axis = axisHist->GetXaxis();
+  double_t min = axis->GetBinLowEdge(axis->GetFirst());
+  double_t max = axis->GetBinUpEdge(axis->GetLast());
+  pixel_columns_t columns;
+  columns.isLog = pad->GetLogx() && min > 0.;
+  if (columns.isLog) {
+    min = std::log10(min);
+    max = std::log10(max);
+  }
+  int32_t pad_width{pad->XtoPixel(pad->GetX2())};
+  columns.n = std::max(static_cast<int32_t>(pad_width * (1. - pad->GetLeftMargin() - pad->GetRightMargin())), 1);
+  columns.min = min;
+  columns.width = (max > min) ? (max - min) / columns.n : 1.;
+  return columns;
+}
+
+//**************************************************************************************************
+/**
+ * Adds the points [first, last) that fall into one pixel column and define what is visible there:
+ * the first and last point as well as the extreme values with and without their errors.
+ */
+//**************************************************************************************************
+template <typename Value, typename Low, typename High>
+void PlotPainter::SelectExtrema(int32_t first, int32_t last, Value value, Low low, High high, vector<int32_t>& selected)
+{
+  int32_t iMin{first}, iMax{first}, iLow{first}, iHigh{first};
+  for (int32_t i = first + 1; i < last; ++i) {
+    if (value(i) < value(iMin)) iMin = i;
+    if (value(i) > value(iMax)) iMax = i;
+    if (low(i) < low(iLow)) iLow = i;
+    if (high(i) > high(iHigh)) iHigh = i;
   }
+  std::array<int32_t, 6> extrema{first, iMin, iMax, iLow, iHigh, last - 1};
+  std::sort(extrema.begin(), extrema.end());
+  std::unique_copy(extrema.begin(), extrema.end(), std::back_inserter(selected));
+}
+
+//**************************************************************************************************
+/**
+ * Reduces a 1d graph to the points that are distinguishable in the pad (min/max per pixel column including errors).
+ * The graph must be sorted in x.
+ */
+//**************************************************************************************************
+void PlotPainter::DecimateGraph(TGraph* graph, const pixel_columns_t& columns)
+{
+  int32_t nPoints = graph->GetN();
+  if (nPoints <= 2 * columns.n) return;
+  PROFILE_SCOPE_DETAIL("paint", "Decimate", graph->GetName());
+
+  double_t* x = graph->GetX();
+  double_t* y = graph->GetY();
+  auto value = [&](int32_t i) { return y[i]; };
+  auto low = [&](int32_t i) { return y[i] - std::max(graph->GetErrorYlow(i), 0.); };
+  auto high = [&](int32_t i) { return y[i] + std::max(graph->GetErrorYhigh(i), 0.); };
+
+  vector<int32_t> selected;
+  int32_t first{};
+  for (int32_t i = 1; i <= nPoints; ++i) {
+    if (i < nPoints && columns(x[i]) == columns(x[first])) continue;
+    SelectExtrema(first, i, value, low, high, selected);
+    first = i;
+  }
+  if (selected.size() == static_cast<size_t>(nPoints)) return;
+
+  // the different graph types partially share their error arrays
+  vector<double_t*> arrays{x, y, graph->GetEX(), graph->GetEXlow(), graph->GetEXhigh()};
+  for (double_t* error : GetErrorArrays(graph)) arrays.push_back(error);
+  std::sort(arrays.begin(), arrays.end());
+  arrays.erase(std::unique(arrays.begin(), arrays.end()), arrays.end());
+  for (double_t* array : arrays) {
+    if (!array) continue;
+    for (size_t i = 0; i < selected.size(); ++i) {
+      array[i] = array[selected[i]];
+    }
+  }
+  graph->Set(selected.size());
+}
+
+//**************************************************************************************************
+/**
+ * Reduces a fine-binned 1d histogram to the bins that are distinguishable in the pad. In each pixel column
+ * the bins with extreme values (including errors) are kept and widened to cover the bins next to them.
+ */
+//**************************************************************************************************
+void PlotPainter::DecimateHist(TH1* hist, const pixel_columns_t& columns)
+{
+  int32_t nBins = hist->GetNbinsX();
+  TAxis* axis = hist->GetXaxis();
+  // profiles store sums and labels refer to individual bins
+  if (nBins <= 2 * columns.n || hist->InheritsFrom(TProfile::Class()) || axis->GetLabels()) return;
+  PROFILE_SCOPE_DETAIL("paint", "Decimate", hist->GetName());
+
+  auto value = [&](int32_t bin) { return hist->GetBinContent(bin); };
+  auto low = [&](int32_t bin) { return hist->GetBinContent(bin) - hist->GetBinError(bin); };
+  auto high = [&](int32_t bin) { return hist->GetBinContent(bin) + hist->GetBinError(bin); };
+
+  vector<int32_t> selected{0};
+  vector<double_t> edges;
+  int32_t first{1};
+  for (int32_t bin = 2; bin <= nBins + 1; ++bin) {
+    if (bin <= nBins && columns(axis->GetBinCenter(bin)) == columns(axis->GetBinCenter(first))) continue;
+    size_t nSelected = selected.size();
+    SelectExtrema(first, bin, value, low, high, selected);
+    edges.push_back(axis->GetBinLowEdge(first));
+    for (size_t i = nSelected + 1; i < selected.size(); ++i) {
+      edges.push_back(axis->GetBinLowEdge(selected[i]));
+    }
+    first = bin;
+  }
+  if (edges.size() == static_cast<size_t>(nBins)) return;
+  edges.push_back(axis->GetBinUpEdge(nBins));
+  selected.push_back(nBins + 1);
+
+  vector<double_t> contents(selected.size());
+  vector<double_t> errors(selected.size());
+  for (size_t i = 0; i < selected.size(); ++i) {
+    contents[i] = hist->GetBinContent(selected[i]);
+    errors[i] = hist->GetBinError(selected[i]);
+  }
+  bool hasErrors = hist->GetSumw2N() > 0;
+  double_t entries = hist->GetEntries();
+  // legend labels show the statistics of the original histogram
+  mUndecimatedStatistics[hist] = {hist->Integral(), hist->GetMean()};
+  double_t rangeMin = axis->GetBinLowEdge(axis->GetFirst());
+  double_t rangeMax = axis->GetBinUpEdge(axis->GetLast());
+
+  hist->SetBins(edges.size() - 1, edges.data());
+  for (size_t i = 0; i < selected.size(); ++i) {
+    hist->SetBinContent(i, contents[i]);
+    if (hasErrors) hist->SetBinError(i, errors[i]);
+  }
+  hist->SetEntries(entries);
+  axis->SetRangeUser(rangeMin, rangeMax);
 }
 
 //**************************************************************************************************
@@ -1531,6 +2201,13 @@ tuple<uint32_t, uint32_t> PlotPainter::GetTextDimensions(TLatex& text, TPad* pad
   uint32_t height{};
   int16_t font{text.GetTextFont()};
 
+  // measuring requires the LaTeX engine of ROOT, so re-use the result for identical text in pads of the same size
+  text_extent_cache_t::key_t key{text.GetTitle(), font, text.GetTextSize(), pad->XtoPixel(pad->GetX2()), pad->YtoPixel(pad->GetY1())};
+  if (auto extent = mTextExtentCache->extents.find(key); extent != mTextExtentCache->extents.end()) {
+    return extent->second;
+  }
+
+  PROFILE_SCOPE("paint", "MeasureText");
   bool isBatch = gPad->IsBatch();
   if (isBatch) {
     // in batch mode ROOT calculates the bounding LaTex boxes wrongly, therefore disable it for the calculation
@@ -1551,9 +2228,70 @@ tuple<uint32_t, uint32_t> PlotPainter::GetTextDimensions(TLatex& text, TPad* pad
     gPad->SetBatch(true);
     gROOT->SetBatch(true);
   }
+  mTextExtentCache->extents[key] = {width, height};
+  mTextExtentCache->isModified = true;
   return {width, height};
 }
 
+//**************************************************************************************************
+/**
+ * Adds the text extents stored in file to the cache. Measurements from other ROOT versions are ignored.
+ */
+//**************************************************************************************************
+bool text_extent_cache_t::Load(const string& fileName)
+{
+  std::ifstream cacheFile(fileName);
+  string line;
+  if (!cacheFile || !std::getline(cacheFile, line) || line != gTextExtentCacheHeader) return false;
+  if (!std::getline(cacheFile, line) || line != std::to_string(gROOT->GetVersionInt())) return false;
+  while (std::getline(cacheFile, line)) {
+    // text is stored last since it may contain the delimiter itself
+    std::istringstream entry(line);
+    int16_t font{};
+    float_t size{};
+    int32_t padWidth{};
+    int32_t padHeight{};
+    uint32_t width{};
+    uint32_t height{};
+    if (!(entry >> font >> size >> padWidth >> padHeight >> width >> height) || entry.get() != '\t') continue;
+    string text;
+    std::getline(entry, text);
+    extents.insert({{text, font, size, padWidth, padHeight}, {width, height}});
+  }
+  return true;
+}
+
+//**************************************************************************************************
+/**
+ * Writes the cached text extents to file.
+ */
+//**************************************************************************************************
+void text_extent_cache_t::Save(const string& fileName) const
+{
+  std::error_code errorCode;
+  auto parentDir = std::filesystem::path(fileName).parent_path();
+  if (!parentDir.empty()) std::filesystem::create_directories(parentDir, errorCode);
+  // write to temporary file first so concurrent runs never see incomplete caches
+  string tmpFileName = fileName + "." + std::to_string(getpid());
+  {
+    std::ofstream cacheFile(tmpFileName);
+    if (!cacheFile) {
+      WARNING("Cannot write text extent cache {}.", fileName);
+      return;
+    }
+    cacheFile << gTextExtentCacheHeader << "\n"
+              << gROOT->GetVersionInt() << "\n"
+              << std::setprecision(std::numeric_limits<float_t>::max_digits10);
+    for (auto& [key, extent] : extents) {
+      auto& [text, font, size, padWidth, padHeight] = key;
+      cacheFile << font << " " << size << " " << padWidth << " " << padHeight << " "
+                << std::get<0>(extent) << " " << std::get<1>(extent) << "\t" << text << "\n";
+    }
+  }
+  std::filesystem::rename(tmpFileName, fileName, errorCode);
+  if (errorCode) std::filesystem::remove(tmpFileName, errorCode);
+}
+
 //**************************************************************************************************
 /**
  * Converts NDC text size to pixel.
@@ -1569,61 +2307,57 @@ float_t PlotPainter::GetTextSizePixel(float_t textSizeNDC)
 
 //**************************************************************************************************
 /**
- * Function to replace placeholders in labels.
+ * Function to fill the placeholders of pre-compiled labels with properties of the data.
  */
 //**************************************************************************************************
-void PlotPainter::ReplacePlaceholders(string& str, TNamed* data_ptr)
+string PlotPainter::FillPlaceholders(const label_template_t& labelTemplate, TNamed* data_ptr)
 {
-  std::regex words_regex("<[name,title,entries,integral,mean,maximum,minimum].*?>");
-  auto words_begin = std::sregex_iterator(str.begin(), str.end(), words_regex);
-  auto words_end = std::sregex_iterator();
-
-  for (std::sregex_iterator match = words_begin; match != words_end; ++match) {
-    std::string match_str = match->str();
-    string format{};
-
-    // check if user specified different formatting (e.g. via <mean[%2.6]>)
-    std::regex format_regex("\\[.*?\\]");
-    if (auto format_it = std::sregex_iterator(match_str.begin(), match_str.end(), format_regex); format_it != std::sregex_iterator()) {
-      format = format_it->str();
-      format = format.substr(1, format.size() - 2);
-    }
-    // allow printf style and protect against wrong usage
-    format.erase(remove(format.begin(), format.end(), '%'), format.end());
-    format.erase(remove(format.begin(), format.end(), ' '), format.end());
-
-    // if no valid formatting pattern is given, fall back to 'general' mode
-    if (!(str_contains(format, "e") || str_contains(format, "f") || str_contains(format, "g") || str_contains(format, "E") || str_contains(format, "F") || str_contains(format, "G"))) {
-      format = format + "g";
-    }
-    format = "{:" + format + "}";
-
-    string replace_str = match_str;
-    if (str_contains(match_str, "name")) {
-      replace_str = data_ptr->GetName();
-      replace_str = replace_str.substr(0, replace_str.find(gNameGroupSeparator));
-    } else if (str_contains(match_str, "title")) {
-      replace_str = data_ptr->GetTitle();
+  using placeholder_t = label_template_t::placeholder_t;
+  string label;
+  for (auto& token : labelTemplate.tokens) {
+    label += token.literal;
+    if (token.placeholder == placeholder_t::none) continue;
+
+    if (token.placeholder == placeholder_t::name) {
+      string name = data_ptr->GetName();
+      label += name.substr(0, name.find(gNameGroupSeparator));
+    } else if (token.placeholder == placeholder_t::title) {
+      label += data_ptr->GetTitle();
     } else if (data_ptr->InheritsFrom(TH1::Class())) {
+      TH1* hist = static_cast<TH1*>(data_ptr);
+      auto undecimatedStatistics = mUndecimatedStatistics.find(hist);
+      bool isDecimated = (undecimatedStatistics != mUndecimatedStatistics.end());
       try {
-        if (str_contains(match_str, "entries")) {
-          replace_str = fmt::format(format, static_cast<TH1*>(data_ptr)->GetEntries());
-        } else if (str_contains(match_str, "integral")) {
-          replace_str = fmt::format(format, static_cast<TH1*>(data_ptr)->Integral());
-        } else if (str_contains(match_str, "mean")) {
-          replace_str = fmt::format(format, static_cast<TH1*>(data_ptr)->GetMean());
-        } else if (str_contains(match_str, "maximum")) {
-          replace_str = fmt::format(format, static_cast<TH1*>(data_ptr)->GetMaximum());
-        } else if (str_contains(match_str, "minimum")) {
-          replace_str = fmt::format(format, static_cast<TH1*>(data_ptr)->GetMinimum());
+        double_t value{};
+        switch (token.placeholder) {
+          case placeholder_t::entries:
+            value = hist->GetEntries();
+            break;
+          case placeholder_t::integral:
+            value = (isDecimated) ? undecimatedStatistics->second.integral : hist->Integral();
+            break;
+          case placeholder_t::mean:
+            value = (isDecimated) ? undecimatedStatistics->second.mean : hist->GetMean();
+            break;
+          case placeholder_t::maximum:
+            value = hist->GetMaximum();
+            break;
+          case placeholder_t::minimum:
+            value = hist->GetMinimum();
+            break;
+          default:
+            break;
         }
+        label += fmt::format(token.format, value);
       } catch (...) {
-        ERROR("Incompatible format string in {}.", match_str);
-        replace_str = match_str;
+        ERROR("Incompatible format string in {}.", token.original);
+        label += token.original;
       }
+    } else {
+      label += token.original;
     }
-    str.replace(str.find(match_str), string(match_str).size(), replace_str);
   }
+  return label;
 }
 
 //**************************************************************************************************
@@ -1633,6 +2367,14 @@ void PlotPainter::ReplacePlaceholders(string& str, TNamed* data_ptr)
 //**************************************************************************************************
 vector<int16_t> PlotPainter::GenerateGradientColors(int32_t nColors, const vector<tuple<float_t, float_t, float_t, float_t>>& rgbEndpoints, float_t alpha, bool savePalette)
 {
+  // colors are global in ROOT, so gradients are only created once per process
+  static map<tuple<vector<tuple<float_t, float_t, float_t, float_t>>, int32_t, float_t>, vector<int16_t>> gradients; // endpoints, nColors, alpha
+  auto& gradientColors = gradients[{rgbEndpoints, nColors, alpha}];
+  if (!gradientColors.empty()) {
+    if (savePalette) gStyle->SetPalette(gradientColors.size(), vector<int32_t>(gradientColors.begin(), gradientColors.end()).data());
+    return gradientColors;
+  }
+
   uint16_t nPoints = rgbEndpoints.size();
 
   vector<double_t> red;
@@ -1647,8 +2389,9 @@ vector<int16_t> PlotPainter::GenerateGradientColors(int32_t nColors, const vecto
     stops.push_back(std::get<3>(rgb));
   }
   int16_t firstColorIndex = TColor::CreateGradientColorTable(nPoints, stops.data(), red.data(), green.data(), blue.data(), nColors, alpha);
+  if (firstColorIndex < 0) return {};
 
-  vector<int16_t> gradientColors(nColors);
+  gradientColors.resize(nColors);
   std::iota(gradientColors.begin(), gradientColors.end(), firstColorIndex);
 
   // TColor::CreateGradientColorTable() changes current palette as side effect
@@ -1656,4 +2399,24 @@ vector<int16_t> PlotPainter::GenerateGradientColors(int32_t nColors, const vecto
   return gradientColors;
 }
 
+//**************************************************************************************************
+/**
+ * Transparent version of a color. Each combination of rgb values and opacity is only added once to the color table of ROOT,
+ * which otherwise grows with each call of TColor::GetColorTransparent() and is limited to int16 indices.
+ */
+//**************************************************************************************************
+int16_t PlotPainter::GetTransparentColor(int16_t color, float_t opacity)
+{
+  TColor* baseColor = gROOT->GetColor(color);
+  if (!baseColor) return color;
+  static map<tuple<float_t, float_t, float_t, float_t>, int16_t> transparentColors; // rgba, color index
+  float_t red{};
+  float_t green{};
+  float_t blue{};
+  baseColor->GetRGB(red, green, blue);
+  auto [transparentColor, isNew] = transparentColors.try_emplace({red, green, blue, opacity}, 0);
+  if (isNew) transparentColor->second = TColor::GetColorTransparent(color, opacity);
+  return transparentColor->second;
+}
+
 } // end namespace SciRooPlot
@@ -0,0 +1,283 @@
+/*
+********************************************************************************
+* --------------------------------- SciRooPlot ---------------------------------
+* Copyright (c) 2019-2023 Mario Krüger
+* Contact: mario.kruger@cern.ch
+* For a full list of contributors please see doc/CONTRIBUTORS.md.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation in version 3 (or later) of the License.
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+* See the GNU General Public License for more details.
+* The GNU General Public License can be found here: <http://www.gnu.org/licenses/>.
+*******************************************************************************
+*/
+
+#include "Profiling.h"
+#include "Logging.h"
+#include "Helpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+namespace SciRooPlot
+{
+//**************************************************************************************************
+/**
+ * Access the profiler of this process. Profiling is enabled right away if requested via environment variable.
+ */
+//**************************************************************************************************
+Profiler& Profiler::Instance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler() : mStartTime{std::chrono::steady_clock::now()}
+{
+  if (const char* traceFileName = std::getenv("SCIROOPLOT_TRACE"); traceFileName && *traceFileName) {
+    mTraceFileName = traceFileName;
+    sIsEnabled = true;
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Enable profiling. The trace is written to the specified file at the end of the run.
+ */
+//**************************************************************************************************
+void Profiler::Enable(const string& traceFileName)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mTraceFileName = traceFileName;
+  sIsEnabled = !traceFileName.empty();
+}
+
+//**************************************************************************************************
+/**
+ * Time since start of the profiler in microseconds.
+ */
+//**************************************************************************************************
+int64_t Profiler::GetTime() const
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - mStartTime).count();
+}
+
+//**************************************************************************************************
+/**
+ * Resident memory of the current process in kB.
+ */
+//**************************************************************************************************
+int64_t Profiler::GetResidentMemory()
+{
+#ifdef __APPLE__
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) return 0;
+  return static_cast<int64_t>(info.resident_size / 1024);
+#else
+  std::ifstream statm("/proc/self/statm");
+  int64_t totalPages{};
+  int64_t residentPages{};
+  if (!(statm >> totalPages >> residentPages)) return 0;
+  return residentPages * sysconf(_SC_PAGESIZE) / 1024;
+#endif
+}
+
+//**************************************************************************************************
+/**
+ * Small consecutive number identifying the current thread in the trace.
+ */
+//**************************************************************************************************
+uint32_t Profiler::GetThreadID()
+{
+  static std::atomic<uint32_t> nThreads{0u};
+  thread_local uint32_t threadID{nThreads++};
+  return threadID;
+}
+
+//**************************************************************************************************
+/**
+ * Store event.
+ */
+//**************************************************************************************************
+void Profiler::AddEvent(event_t&& event)
+{
+  event.pid = getpid();
+  std::lock_guard<std::mutex> lock(mMutex);
+  mEvents.push_back(std::move(event));
+}
+
+//**************************************************************************************************
+/**
+ * Store value of a counter.
+ */
+//**************************************************************************************************
+void Profiler::Count(const string& name, int64_t value)
+{
+  AddEvent({"counter", name, {}, GetTime(), -1, value, 0, GetThreadID()});
+}
+
+//**************************************************************************************************
+/**
+ * Save events to file (tab separated), such that they can be merged by the parent process.
+ */
+//**************************************************************************************************
+void Profiler::SaveEvents(const string& fileName) const
+{
+  auto clean = [](string text) {
+    std::replace(text.begin(), text.end(), '\t', ' ');
+    std::replace(text.begin(), text.end(), '\n', ' ');
+    return text;
+  };
+  std::ofstream eventFile(fileName);
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (auto& event : mEvents) {
+    eventFile << clean(event.category) << '\t' << clean(event.name) << '\t' << clean(event.detail) << '\t' << event.start << '\t' << event.duration << '\t' << event.value << '\t' << event.pid << '\t' << event.tid << '\n';
+  }
+}
+
+//**************************************************************************************************
+/**
+ * Load events saved by another process. Events already known are not added again.
+ */
+//**************************************************************************************************
+bool Profiler::LoadEvents(const string& fileName)
+{
+  std::ifstream eventFile(fileName);
+  if (!eventFile) return false;
+  int32_t ownPID = getpid();
+  string line;
+  std::lock_guard<std::mutex> lock(mMutex);
+  while (std::getline(eventFile, line)) {
+    vector<string> fields;
+    std::istringstream lineStream(line);
+    for (string field; std::getline(lineStream, field, '\t');) {
+      fields.push_back(field);
+    }
+    if (fields.size() != 8u) continue;
+    event_t event{fields[0], fields[1], fields[2], std::stoll(fields[3]), std::stoll(fields[4]), std::stoll(fields[5]), std::stoi(fields[6]), static_cast<uint32_t>(std::stoul(fields[7]))};
+    // forked workers inherit the events recorded before the fork
+    if (event.pid == ownPID) continue;
+    mEvents.push_back(std::move(event));
+  }
+  return true;
+}
+
+//**************************************************************************************************
+/**
+ * Write trace file and print summary.
+ */
+//**************************************************************************************************
+void Profiler::Finish() const
+{
+  if (!IsEnabled()) return;
+  WriteTrace(mTraceFileName);
+  PrintSummary();
+}
+
+//**************************************************************************************************
+/**
+ * Write events in the Chrome trace event format (can be viewed with chrome://tracing or ui.perfetto.dev).
+ */
+//**************************************************************************************************
+void Profiler::WriteTrace(const string& fileName) const
+{
+  auto escape = [](const string& text) {
+    string escaped;
+    for (char c : text) {
+      if (c == '"' || c == '\\') escaped += '\\';
+      if (static_cast<unsigned char>(c) < 0x20) continue;
+      escaped += c;
+    }
+    return escaped;
+  };
+
+  string expandedFileName = expand_path(fileName);
+  string tmpFileName = expandedFileName + ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream traceFile(tmpFileName);
+    if (!traceFile) {
+      ERROR("Cannot write trace to {}.", fileName);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    traceFile << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (size_t i = 0; i < mEvents.size(); ++i) {
+      auto& event = mEvents[i];
+      if (event.duration < 0) {
+        traceFile << fmt::format(R"(  {{"name": "{}", "ph": "C", "ts": {}, "pid": {}, "tid": {}, "args": {{"value": {}}}}})",
+                                 escape(event.name), event.start, event.pid, event.tid, event.value);
+      } else {
+        traceFile << fmt::format(R"(  {{"name": "{}", "cat": "{}", "ph": "X", "ts": {}, "dur": {}, "pid": {}, "tid": {}, "args": {{"detail": "{}", "rss_delta_kB": {}}}}})",
+                                 escape(event.name), escape(event.category), event.start, event.duration, event.pid, event.tid, escape(event.detail), event.value);
+      }
+      traceFile << ((i + 1 < mEvents.size()) ? ",\n" : "\n");
+    }
+    traceFile << "]}\n";
+  }
+  std::error_code errorCode;
+  std::filesystem::rename(tmpFileName, expandedFileName, errorCode);
+  if (errorCode) {
+    ERROR("Cannot write trace to {}.", fileName);
+    std::filesystem::remove(tmpFileName, errorCode);
+    return;
+  }
+  INFO("Wrote trace to {}.", fileName);
+}
+
+//**************************************************************************************************
+/**
+ * Print table with total time spent in each phase and the plots that needed most memory.
+ */
+//**************************************************************************************************
+void Profiler::PrintSummary() const
+{
+  struct phase_t {
+    uint64_t calls{};
+    int64_t total{};
+    int64_t max{};
+    int64_t rssDelta{};
+  };
+  map<std::pair<string, string>, phase_t> phases;
+  vector<std::pair<int64_t, string>> plotMemory;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& event : mEvents) {
+      if (event.duration < 0) continue;
+      auto& phase = phases[{event.category, event.name}];
+      ++phase.calls;
+      phase.total += event.duration;
+      phase.max = std::max(phase.max, event.duration);
+      phase.rssDelta += event.value;
+      if (event.category == "plot") plotMemory.push_back({event.value, event.detail});
+    }
+  }
+
+  INFO("================= Profiling ===================");
+  PRINT("{:<12} {:<22} {:>8} {:>12} {:>12} {:>12} {:>12}", "category", "phase", "calls", "total [ms]", "mean [ms]", "max [ms]", "rss [MB]");
+  PRINT_SEPARATOR;
+  for (auto& [key, phase] : phases) {
+    PRINT("{:<12} {:<22} {:>8} {:>12.2f} {:>12.3f} {:>12.3f} {:>12.1f}", key.first, key.second, phase.calls, phase.total / 1e3,
+          phase.total / 1e3 / phase.calls, phase.max / 1e3, phase.rssDelta / 1024.);
+  }
+  if (!plotMemory.empty()) {
+    std::sort(plotMemory.begin(), plotMemory.end(), std::greater<>());
+    PRINT_SEPARATOR;
+    PRINT("plots with largest increase of resident memory:");
+    for (size_t i = 0; i < std::min<size_t>(plotMemory.size(), 10u); ++i) {
+      PRINT("{:>10.1f} MB  {}", plotMemory[i].first / 1024., plotMemory[i].second);
+    }
+  }
+  INFO("===============================================");
+}
+} // end namespace SciRooPlot